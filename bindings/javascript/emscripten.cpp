@@ -44,6 +44,9 @@ EMSCRIPTEN_BINDINGS(ggwave) {
     emscripten::constant("GGWAVE_OPERATING_MODE_RX_AND_TX",     (int) GGWAVE_OPERATING_MODE_RX | GGWAVE_OPERATING_MODE_TX);
     emscripten::constant("GGWAVE_OPERATING_MODE_TX_ONLY_TONES", (int) GGWAVE_OPERATING_MODE_TX_ONLY_TONES);
     emscripten::constant("GGWAVE_OPERATING_MODE_USE_DSS",       (int) GGWAVE_OPERATING_MODE_USE_DSS);
+    emscripten::constant("GGWAVE_OPERATING_MODE_RX_AMORTIZED",  (int) GGWAVE_OPERATING_MODE_RX_AMORTIZED);
+    emscripten::constant("GGWAVE_OPERATING_MODE_TX_OSCILLATOR", (int) GGWAVE_OPERATING_MODE_TX_OSCILLATOR);
+    emscripten::constant("GGWAVE_OPERATING_MODE_TX_STREAMING",  (int) GGWAVE_OPERATING_MODE_TX_STREAMING);
 
     emscripten::value_object<ggwave_Parameters>("Parameters")
         .field("payloadLength",        & ggwave_Parameters::payloadLength)
@@ -66,14 +69,14 @@ EMSCRIPTEN_BINDINGS(ggwave) {
                        const std::string & data,
                        ggwave_ProtocolId protocolId,
                        int volume) {
-                        auto n = ggwave_encode(instance, data.data(), data.size(), protocolId, volume, nullptr, 1);
+                        auto n = ggwave_txBegin(instance, data.data(), data.size(), protocolId, volume);
 
                         // TODO: how to return the waveform data?
                         //       for now using this static vector and returning a pointer to it
-                        static std::vector<char> result(n);
-                        result.resize(n);
+                        static std::vector<char> result;
+                        result.resize(n > 0 ? n : 0);
 
-                        int nActual = ggwave_encode(instance, data.data(), data.size(), protocolId, volume, result.data(), 0);
+                        int nActual = n > 0 ? ggwave_txRender(instance, result.data(), n) : 0;
 
                         // printf("n = %d, nActual = %d\n", n, nActual);
                         return emscripten::val(emscripten::typed_memory_view(nActual, result.data()));
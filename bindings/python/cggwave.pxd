@@ -38,7 +38,10 @@ cdef extern from "ggwave.h" nogil:
         GGWAVE_OPERATING_MODE_TX,
         GGWAVE_OPERATING_MODE_RX_AND_TX,
         GGWAVE_OPERATING_MODE_TX_ONLY_TONES,
-        GGWAVE_OPERATING_MODE_USE_DSS
+        GGWAVE_OPERATING_MODE_USE_DSS,
+        GGWAVE_OPERATING_MODE_RX_AMORTIZED,
+        GGWAVE_OPERATING_MODE_TX_OSCILLATOR,
+        GGWAVE_OPERATING_MODE_TX_STREAMING
 
     ctypedef struct ggwave_Parameters:
         int payloadLength
@@ -68,6 +71,27 @@ cdef extern from "ggwave.h" nogil:
             void * waveformBuffer,
             int query);
 
+    int ggwave_nencode(
+            ggwave_Instance instance,
+            const void * payloadBuffer,
+            int payloadSize,
+            ggwave_ProtocolId protocolId,
+            int volume,
+            void * waveformBuffer,
+            int waveformSize);
+
+    int ggwave_txBegin(
+            ggwave_Instance instance,
+            const void * payloadBuffer,
+            int payloadSize,
+            ggwave_ProtocolId protocolId,
+            int volume);
+
+    int ggwave_txRender(
+            ggwave_Instance instance,
+            void * waveformBuffer,
+            int waveformSize);
+
     int ggwave_decode(
             ggwave_Instance instance,
             const void * waveformBuffer,
@@ -37,12 +37,17 @@ def encode(payload, protocolId = 1, volume = 10, instance = None):
         own = True
         instance = init(getDefaultParameters())
 
-    n = cggwave.ggwave_encode(instance, cdata, len(data_bytes), protocolId, volume, NULL, 1)
+    n = cggwave.ggwave_txBegin(instance, cdata, len(data_bytes), protocolId, volume)
+
+    if (n < 0):
+        if (own):
+            free(instance)
+        raise ValueError("Failed to encode the payload")
 
     cdef bytes output_bytes = bytes(n)
     cdef char* coutput = output_bytes
 
-    n = cggwave.ggwave_encode(instance, cdata, len(data_bytes), protocolId, volume, coutput, 0)
+    cggwave.ggwave_txRender(instance, coutput, n)
 
     if (own):
         free(instance)
@@ -93,6 +93,24 @@ extern "C" {
     //   GGWAVE_OPERATING_MODE_USE_DSS:
     //     Enable the built-in Direct Sequence Spread (DSS) algorithm
     //
+    //   GGWAVE_OPERATING_MODE_RX_AMORTIZED:
+    //     Split the analysis of the received variable-length data in small pieces of work,
+    //     instead of doing all of it in the decode() call that completes the reception.
+    //     Each captured frame advances the analysis for up to kDefaultRxStepBudget_us.
+    //     Use rxStep() to advance it further, for example while the application is idle.
+    //     Meanwhile, the next transmission can already be received. If it ends before the
+    //     analysis of the previous one, its analysis starts when the previous one completes.
+    //     No other transmission is received while a completed recording waits for its analysis.
+    //
+    //   GGWAVE_OPERATING_MODE_TX_OSCILLATOR:
+    //     Generate only the active tones of each frame with complex rotators, instead of mixing
+    //     precomputed waveforms of all tones. Uses less memory and the cost of each frame is
+    //     proportional to the number of active tones. The output matches the default up to rounding.
+    //
+    //   GGWAVE_OPERATING_MODE_TX_STREAMING:
+    //     Do not allocate buffers for the full Tx waveform. The waveform is rendered frame by frame
+    //     into caller-provided buffers with txBegin() and txRender(). encode() is not available.
+    //
     enum {
         GGWAVE_OPERATING_MODE_RX            = 1 << 1,
         GGWAVE_OPERATING_MODE_TX            = 1 << 2,
@@ -100,6 +118,9 @@ extern "C" {
                                                GGWAVE_OPERATING_MODE_TX),
         GGWAVE_OPERATING_MODE_TX_ONLY_TONES = 1 << 3,
         GGWAVE_OPERATING_MODE_USE_DSS       = 1 << 4,
+        GGWAVE_OPERATING_MODE_RX_AMORTIZED  = 1 << 5,
+        GGWAVE_OPERATING_MODE_TX_OSCILLATOR = 1 << 6,
+        GGWAVE_OPERATING_MODE_TX_STREAMING  = 1 << 7,
     };
 
     // GGWave instance parameters
@@ -236,6 +257,74 @@ extern "C" {
             void * waveformBuffer,
             int query);
 
+    // Memory-safe, single-pass version of ggwave_encode
+    //
+    //   waveformSize - size of the output buffer in bytes
+    //
+    //   The waveform is rendered directly into waveformBuffer, without an intermediate copy.
+    //   This also works for instances created with GGWAVE_OPERATING_MODE_TX_STREAMING.
+    //
+    //   If waveformBuffer is NULL, returns the exact number of bytes in the waveform without encoding.
+    //   The size depends only on the instance parameters, payloadSize and protocolId.
+    //
+    //   If the return value is -2 then the provided waveformBuffer is not big enough to
+    //   store the waveform.
+    //
+    //   returns -1 if there was an error, for example an empty payload
+    //
+    //   Example:
+    //
+    //     int n = ggwave_nencode(instance, payload, 4, GGWAVE_PROTOCOL_AUDIBLE_FAST, 25, NULL, 0);
+    //
+    //     char * waveform = malloc(n);
+    //
+    //     ggwave_nencode(instance, payload, 4, GGWAVE_PROTOCOL_AUDIBLE_FAST, 25, waveform, n);
+    //
+    GGWAVE_API int ggwave_nencode(
+            ggwave_Instance instance,
+            const void * payloadBuffer,
+            int payloadSize,
+            ggwave_ProtocolId protocolId,
+            int volume,
+            void * waveformBuffer,
+            int waveformSize);
+
+    // Begin rendering the waveform of a payload into caller-provided buffers
+    //
+    //   Initializes the transmission and returns the number of bytes in its waveform, so that the output buffer can
+    //   be allocated before rendering it with ggwave_txRender(). Unlike querying the size with ggwave_nencode(), the
+    //   payload is encoded only once.
+    //
+    //   returns -1 if there was an error, for example an empty payload
+    //
+    //   Example:
+    //
+    //     int n = ggwave_txBegin(instance, payload, 4, GGWAVE_PROTOCOL_AUDIBLE_FAST, 25);
+    //
+    //     char * waveform = malloc(n);
+    //
+    //     ggwave_txRender(instance, waveform, n);
+    //
+    GGWAVE_API int ggwave_txBegin(
+            ggwave_Instance instance,
+            const void * payloadBuffer,
+            int payloadSize,
+            ggwave_ProtocolId protocolId,
+            int volume);
+
+    // Render the next part of the waveform started with ggwave_txBegin()
+    //
+    //   waveformSize - size of the output buffer in bytes
+    //
+    //   returns the number of written bytes. Less than waveformSize only at the end of the waveform, 0 when done
+    //
+    //   returns -1 if there was an error
+    //
+    GGWAVE_API int ggwave_txRender(
+            ggwave_Instance instance,
+            void * waveformBuffer,
+            int waveformSize);
+
     // Decode an audio waveform into data
     //
     //   instance       - the GGWave instance to use
@@ -398,7 +487,7 @@ public:
     ggmatrix() : m_data(nullptr), m_size0(0), m_size1(0) {}
     ggmatrix(T * data, int size0, int size1) : m_data(data), m_size0(size0), m_size1(size1) {}
 
-    ggvector<T> operator[](int i) {
+    ggvector<T> operator[](int i) const {
         return ggvector<T>(m_data + i*m_size1, m_size1);
     }
 
@@ -428,7 +517,8 @@ public:
     static constexpr auto kDefaultSoundMarkerThreshold = 3.0f;
     static constexpr auto kDefaultMarkerFrames         = 16;
     static constexpr auto kDefaultEncodedDataOffset    = 3;
-    static constexpr auto kMaxSamplesPerFrame          = 1024;
+    static constexpr auto kDefaultRxStepBudget_us      = 1000;
+    static constexpr auto kMaxSamplesPerFrame          = 4096;
     static constexpr auto kMaxDataSize                 = 256;
     static constexpr auto kMaxLengthVariable           = 140;
     static constexpr auto kMaxLengthFixed              = 64;
@@ -564,6 +654,27 @@ public:
     using RecordedData = ggvector<float>;
     using TxRxData     = ggvector<uint8_t>;
 
+    // Executor for running independent pieces of work in parallel
+    //
+    //   GGWave does not create any threads. Instead, an executor can be passed to prepare() in
+    //   order to split the decoding of the variable-length payloads in nWorkers tasks. These are
+    //   independent from each other and can run on a thread pool, a work-stealing scheduler, etc.
+    //
+    //   run(userData, task, taskData, nTasks) must call task(taskData, i) exactly once for each
+    //   i in [0, nTasks) and return only after all calls have finished. The calls can run
+    //   concurrently on different threads.
+    //
+    //   If run is nullptr, all the work is done on the thread that calls decode()
+    //
+    struct Executor {
+        using Task = void (*)(void * taskData, int taskId);
+        using Run  = void (*)(void * userData, Task task, void * taskData, int nTasks);
+
+        Run    run      = nullptr;
+        void * userData = nullptr;
+        int    nWorkers = 1; // number of tasks to split the work in, typically the number of threads
+    };
+
     // Default constructor
     //
     //   The GGWave object is not ready to use until you call prepare()
@@ -625,6 +736,13 @@ public:
     //
     bool prepare(const Parameters & parameters, bool allocate = true);
 
+    // Prepare the GGWave object and use the executor for the decoding of variable-length payloads
+    //
+    //   A separate set of work buffers is allocated for each of the executor workers.
+    //   The decoded data does not depend on the number of workers.
+    //
+    bool prepare(const Parameters & parameters, const Executor & executor, bool allocate = true);
+
     // Set file stream for the internal ggwave logging
     //
     //   By default, ggwave prints internal log messages to stderr.
@@ -646,17 +764,15 @@ public:
     bool init(const char * text, TxProtocolId protocolId, const int volume = kDefaultVolume);
     bool init(int dataSize, const char * dataBuffer, TxProtocolId protocolId, const int volume = kDefaultVolume);
 
-    // Expected waveform size of the encoded Tx data in bytes
+    // Waveform size of the encoded Tx data in bytes
     //
-    //   When the output sampling rate is not equal to operating sample rate the result of this method is overestimation
-    //   of the actual number of bytes that would be produced
+    //   Equal to the number of bytes produced by encode() or txRender(). Computed without encoding the data.
     //
     uint32_t encodeSize_bytes() const;
 
-    // Expected waveform size of the encoded Tx data in samples
+    // Waveform size of the encoded Tx data in samples
     //
-    //   When the output sampling rate is not equal to operating sample rate the result of this method is overestimation
-    //   of the actual number of samples that would be produced
+    //   Equal to the number of samples produced by encode() or txRender(). Computed without encoding the data.
     //
     uint32_t encodeSize_samples() const;
 
@@ -671,6 +787,25 @@ public:
     //
     uint32_t encode();
 
+    // Begin rendering the Tx data into caller-provided buffers
+    //
+    //   Alternative to encode() that does not need a buffer for the full waveform. After calling this method,
+    //   call txRender() until it returns 0. The rendered samples are the same as the ones generated by encode().
+    //
+    //   Returns false if the instance cannot generate waveforms
+    //
+    bool txBegin();
+
+    // Render the next samples of the Tx waveform
+    //
+    //   dst      - buffer for the samples in the format given by sampleFormatOut()
+    //   nSamples - maximum number of samples to write
+    //
+    //   Returns the number of written samples. Less than nSamples only at the end of the waveform, 0 when done.
+    //   Returns 0 if txBegin() has not been called after the last init() or encode().
+    //
+    int txRender(void * dst, int nSamples);
+
     // Decode an audio waveform
     //
     //   data   - pointer to the waveform data
@@ -728,6 +863,22 @@ public:
     // prepare() method, base on the contents of the global GGWave::Protocols::tx()
     const TxProtocols & txProtocols() const;
 
+    // Use the tone templates of another instance
+    //
+    //   The templates are the waveforms of the tones of a Tx protocol. They depend only on the start frequency and the
+    //   number of data bits of the protocol, the sample rate and the samples per frame. encode() computes the templates
+    //   of each such protocol key when it is first used and never overwrites them, so they can be read by other
+    //   instances while the source encodes. With a source, encode() reads the templates that the source had already
+    //   computed at the time of this call, instead of computing its own. Call it again to share templates that the
+    //   source computed later.
+    //
+    //   The source must outlive this instance and must not encode while this method is called.
+    //   Pass nullptr to stop sharing.
+    //
+    //   Returns false if the templates of the source are not compatible with this instance
+    //
+    bool txShareTemplates(const GGWave * source);
+
     //
     // Rx
     //
@@ -742,8 +893,24 @@ public:
     int rxFramesLeftToAnalyze() const;
     int rxDurationFrames()      const;
 
+    // Stop recording the current transmission and drop the analysis in progress, if any
+    //
+    //   Returns false if there was nothing to stop
+    //
     bool rxStopReceiving();
 
+    // Advance the analysis of the received data
+    //
+    //   Works until the analysis is finished or until budget_us microseconds have passed. At least
+    //   one piece of work is done, so the call can take longer than the budget. A negative budget
+    //   finishes the analysis. Use rxFramesLeftToAnalyze() to track the progress.
+    //
+    //   Only needed with GGWAVE_OPERATING_MODE_RX_AMORTIZED - otherwise, decode() does all the work.
+    //
+    //   Returns true if the analysis is still in progress after the call
+    //
+    bool rxStep(int budget_us);
+
     // The instance will attempt to decode only these protocols.
     // They are determined upon construction or when calling the prepare() method, base on the contents of the global
     // GGWave::Protocols::rx()
@@ -771,9 +938,36 @@ public:
     //
     //   Returns true if there was new data available
     //
+    //   In variable-length mode, the spectrum is not computed while idle unless there is a possible
+    //   sound marker in the input. Instead, rxTakeSpectrum() computes it on demand, so rxSpectrum()
+    //   can be out of date while the instance is not receiving.
+    //
+    //   In fixed-length mode, only the bins used by the Rx protocols are computed during decoding and
+    //   the full spectrum of the last frame is computed by rxTakeSpectrum().
+    //
     bool rxTakeSpectrum(Spectrum & dst);
     bool rxTakeAmplitude(Amplitude & dst);
 
+    // Statistics about the work done to decode the last received data
+    //
+    //   In variable-length mode, the statistics are updated when the analysis of a transmission completes. The work
+    //   on the next transmission, which can be recorded during the analysis, is not included.
+    //
+    //   In fixed-length mode, the Reed-Solomon counters accumulate since prepare()
+    //
+    struct RxStats {
+        int nFFT   = 0; // number of full FFTs computed while receiving the data
+        int nSteps = 0; // number of sub-frame spectra computed with the sliding DFT
+
+        int nRSDecodes   = 0; // number of Reed-Solomon decoding attempts
+        int nRSLocator   = 0; // attempts with errors, for which the error locator was computed
+        int nRSChien     = 0; // attempts with a correctable number of errors, for which the positions were searched
+        int nRSCorrected = 0; // attempts in which the errors were corrected
+        int nRSErasures  = 0; // attempts with the least reliable bytes marked as erasures, after a failed attempt
+    };
+
+    const RxStats & rxStats() const;
+
     //
     // Utils
     //
@@ -785,18 +979,20 @@ public:
     //
     //   N must be == samplesPerFrame()
     //
+    //   The output for bin k in [0, N/2) is dst[2*k + 0] (real part) and dst[2*k + 1] (imaginary part with the
+    //   opposite sign), except for bin 0, where dst[1] is the real part of bin N/2. The rest of dst is zero.
+    //
     bool computeFFTR(const float * src, float * dst, int N);
 
     // Compute FFT of real values (static)
     //
     //   src - input real-valued data, size is N
     //   dst - output complex-valued data, size is 2*N
-    //   wi  - work buffer, with size 2*N
-    //   wf  - work buffer, with size 3 + sqrt(N/2)
+    //   wi  - not used anymore, size is 1
+    //   wf  - not used anymore, size is 1
     //
-    //   First time calling this function, make sure that wi[0] == 0
-    //   This will initialize some internal coefficients and store them in wi and wf for
-    //   future usage.
+    //   N must be a power of 2, up to kMaxSamplesPerFrame. The twiddle factors are computed once and shared by
+    //   all callers, so no initialization is needed and the function can be called from multiple threads.
     //
     //   If wi == nullptr                   - returns the needed size for wi
     //   If wi != nullptr and wf == nullptr - returns the needed size for wf
@@ -804,6 +1000,21 @@ public:
     //
     static int computeFFTR(const float * src, float * dst, int N, int * wi, float * wf);
 
+    // Compute the FFTs of multiple frames of real values (static)
+    //
+    //   src    - input real-valued data, frame i is at src + i*stride, size is N
+    //   dst    - output complex-valued data, frame i is at dst + 2*i*N, size is 2*N
+    //   count  - number of frames
+    //   stride - offset between the input frames. Frames overlap if stride < N
+    //
+    //   The output of each frame is the same as the output of computeFFTR(). The frames are transformed in
+    //   small groups that fit in the cache, and the twiddle factors are computed once per group instead of
+    //   once per frame. src must not overlap dst.
+    //
+    //   N must be a power of 2, up to kMaxSamplesPerFrame
+    //
+    static bool computeFFTRBatch(const float * src, float * dst, int N, int count, int stride);
+
     // Filter the waveform
     //
     //   filter   - filter to use
@@ -828,6 +1039,16 @@ public:
     static int filter(ggwave_Filter filter, float * waveform, int N, float p0, float p1, float * w);
 
     // Resample audio waveforms from one sample rate to another using sinc interpolation
+    //
+    //   Polyphase implementation: the windowed sinc filter is precomputed in alloc() for a set of fractional
+    //   delays. An output sample is the dot product of the last kTaps input samples with the bank of its delay.
+    //   The output is delayed by kWidth input samples.
+    //
+    //   When the sample rates are integers with ratio L/M and L <= kMaxPhasesExact, the k-th output sample is
+    //   at input time k*M/L and the L fractional delays are exact. With L == 1 the input is just decimated.
+    //   Otherwise, there are kPhases + 1 banks and each output sample interpolates linearly between the two
+    //   banks around its delay. The time is tracked with integers, so the output does not drift.
+    //
     class Resampler {
     public:
         // this controls the number of neighboring samples
@@ -835,57 +1056,174 @@ public:
         // processing time is linearly related to this width
         static const int kWidth = 64;
 
+        // number of filter taps
+        static const int kTaps = 2*kWidth;
+
+        // number of interpolated coefficient banks per input sample
+        static const int kPhases = 32;
+
+        // max number of banks for sample rates with an exact ratio
+        static const int kMaxPhasesExact = 160;
+
         Resampler();
 
-        bool alloc(void * p, int & n);
+        bool alloc(void * p, int & n, float sampleRateInp, float sampleRateOut);
 
         void reset();
 
-        int nSamplesTotal() const { return m_state.nSamplesTotal; }
-
+        // Number of output samples that resample() produces from the next nSamplesInp input samples
+        int predictOutputSamples(int nSamplesInp) const;
+
+        // Number of input samples that resample() needs in order to produce the next nSamplesOut output samples
+        //
+        //   Feeding them can produce a few more output samples when upsampling
+        //
+        int predictInputSamples(int nSamplesOut) const;
+
+        // Resample the next nSamples of the input stream
+        //
+        //   samplesOut must have space for predictOutputSamples(nSamples) samples
+        //
+        //   Returns the number of output samples
+        //
         int resample(
-                float factor,
                 int nSamples,
                 const float * samplesInp,
                 float * samplesOut);
 
     private:
-        float getData(int j) const;
-        void newData(float data);
-        void makeSinc();
-        double sinc(double x) const;
+        void makeBanks();
+
+        // number of bits of the time between two interpolated banks
+        static const int kPhaseBits = 24;
 
-        static const int kDelaySize = 140;
+        float m_factor = 1.0f; // input sample rate divided by output sample rate
 
-        // this defines how finely the sinc function is sampled for storage in the table
-        static const int kSamplesPerZeroCrossing = 32;
+        // the output sample k is at input time k*m_step/m_timeScale
+        int64_t m_step      = 1;
+        int64_t m_timeScale = 1;
+        bool    m_isExact   = false;
 
-        ggvector<float> m_sincTable;
-        ggvector<float> m_delayBuffer;
-        ggvector<float> m_edgeSamples;
-        ggvector<float> m_samplesInp;
+        ggmatrix<float> m_banks;   // for each fractional delay: the taps, starting with the oldest input sample
+        ggvector<float> m_history; // ring buffer of the last kTaps input samples, stored twice
 
         struct State {
-            int nSamplesTotal = 0;
-            int timeInt       = 0;
-            int timeLast      = 0;
-            double timeNow    = 0.0;
+            int     nSkip      = 0; // input samples to consume before the next output sample
+            int64_t phase      = 0; // fractional input time of the next output sample, in 1/m_timeScale units
+            int     historyPos = 0;
         };
 
         State m_state;
     };
 
+    // Sliding DFT of real values over a selected set of bins
+    //
+    //   Computes the spectrum of N-sample windows that advance by one hop of N/K samples at a time.
+    //   Only the selected bins are evaluated, so each new hop costs O(nBins*N/K) operations instead
+    //   of a full FFT per window. This makes a fine time resolution cheap when few bins are needed.
+    //
+    //   The output for bin k is equal to dst[2*k + 0], dst[2*k + 1] of computeFFTR() applied to the
+    //   current window, up to rounding errors (except for k == 0, where computeFFTR() stores the real
+    //   part of bin N/2 in dst[1]). To avoid the accumulation of rounding errors, the spectrum is
+    //   recomputed from the stored hops every kAnchorHops hops.
+    //
+    //   Memory is provided by the caller through alloc(), the same way as for the GGWave instance:
+    //
+    //     int n = 0;
+    //     sdft.alloc(nullptr, n, N, K, maxBins); // n is the number of bytes needed
+    //     ...
+    //     n = 0;
+    //     sdft.alloc(buffer, n, N, K, maxBins);
+    //
+    class SlidingDFT {
+    public:
+        static const int kAnchorHops = 16;
+
+        SlidingDFT();
+
+        // N       - window size, must be a multiple of nHops
+        // nHops   - number of hops per window (K)
+        // maxBins - max number of bins that can be selected
+        //
+        // If p == nullptr, only the required size is added to n
+        bool alloc(void * p, int & n, int N, int nHops, int maxBins);
+
+        // Select the bins to evaluate. Resets the state
+        bool setBins(const int * bins, int nBins);
+        bool setBins(int binStart, int nBins);
+
+        // Discard all pushed hops
+        void reset();
+
+        // Add the next N/K samples. If hop == nullptr, the samples are zero
+        //
+        //   Returns true if the output is available, i.e. at least K hops have been pushed
+        //
+        bool push(const float * hop);
+
+        // Spectrum of the last K hops - nBins() complex values
+        const float * output() const { return m_output.data(); }
+
+        int nBins()   const { return m_nBins; }
+        int hopSize() const { return m_hopSize; }
+
+    private:
+        void setTwiddles();
+        void anchor();
+
+        int m_N       = 0;
+        int m_nHops   = 0;
+        int m_hopSize = 0;
+        int m_maxBins = 0;
+        int m_nBins   = 0;
+        int m_nPushed = 0;
+
+        ggvector<float> m_cosTable;  // cos(2*pi*i/N)
+        ggvector<int>   m_bins;
+        ggmatrix<float> m_twiddles;  // for each sample of a hop: cos and sin of all bins
+        ggmatrix<float> m_rotations; // for each bin: exp(2*pi*i*bin*q/K) for q in [0, K)
+        ggmatrix<float> m_hops;      // spectra of the last K hops
+        ggvector<float> m_acc;
+        ggvector<float> m_output;
+    };
+
 private:
     bool alloc(void * p, int & n);
 
     void decode_fixed();
+    void resetFixed(int protocolId);
     void decode_variable();
+    void decode_candidates(int nFramesRecorded);
+    void decode_candidate(int bankId, int id, int nFramesRecorded, int workerId);
+    bool decode_final(int iBegin, int iEnd);
+    bool beginAnalysis();
+    void startAnalysis();
+    void analyze(int budget_us);
+
+    void runTasks(Executor::Task task, void * taskData, int nTasks, RxStats & stats);
+
+    bool detectMarkerSparse();
+    void updateSpectrum();
+
+    void advanceSteps(int stepIdLast);
+    const float * stepSpectrum(int bankId, int stepId);
+    bool isStepRangeCached(int bankId, int stepIdFirst, int stepIdLast) const;
+
+    void prepareTx();
+    int frameTones(int frameId, Tone * tones);
+    int renderFrame();
+
+    const uint8_t * rsGenerator(int eccLength) const;
 
     int maxFramesPerTx(const Protocols & protocols, bool excludeMT) const;
     int minBytesPerTx(const Protocols & protocols) const;
     int maxBytesPerTx(const Protocols & protocols) const;
     int maxTonesPerTx(const Protocols & protocols) const;
     int minFreqStart(const Protocols & protocols) const;
+    int txTemplateSets(const Protocols & protocols, int * freqStart, int * dataBits) const;
+    int txTemplateSet(int freqStart, int dataBits) const;
+    int txTemplateRows(int dataBits) const;
+    int maxProtocolsPerFreqStart(const Protocols & protocols) const;
 
     double bitFreq(const Protocol & p, int bit) const;
 
@@ -917,20 +1255,63 @@ private:
 
     bool         m_isRxEnabled          = false;
     bool         m_isTxEnabled          = false;
-    bool         m_needResampling       = false;
+    bool         m_needResamplingInp    = false;
+    bool         m_needResamplingOut    = false;
     bool         m_txOnlyTones          = false;
     bool         m_isDSSEnabled         = false;
+    bool         m_isRxAmortized        = false;
+    bool         m_isTxOscillator       = false;
+    bool         m_isTxStreaming        = false;
+
+    Executor     m_executor;
+    int          m_nWorkers             = 1;
 
     // Common
     TxRxData m_dataEncoded;
     TxRxData m_workRSLength; // Reed-Solomon work buffers
     TxRxData m_workRSData;
 
+    TxRxData      m_rsGenerators;      // Reed-Solomon generator polynomials for the ECC lengths used by the Tx
+    ggvector<int> m_rsGeneratorOffset; // offset in m_rsGenerators for each ECC length, -1 if not used
+
     // Impl
 
+    // A single (protocol, start offset) hypothesis for the location of the variable-length payload
+    //
+    //   The candidates are advanced as new frames are being recorded, so that most of the
+    //   work is done by the time the end marker is received.
+    //
+    struct RxCandidate {
+        int8_t  state;         // pending, complete or rejected
+        int8_t  protocolId;
+        int16_t offset;        // start offset in steps of samplesPerFrame/16
+        int16_t itx;           // index of the next Tx chunk to decode
+        int16_t decodedLength; // 0 if the length is not yet known
+    };
+
+    // The candidates of a single recording and the spectra of its steps
+    //
+    //   There are two banks, so that the next transmission can be recorded while the analysis
+    //   of the previous one is still in progress.
+    //
+    struct RxBank {
+        int nCandidates         = 0;
+        int recvDuration_frames = 0;
+
+        ggvector<RxCandidate> candidates;
+        ggmatrix<uint8_t>     candidatesData;       // encoded data decoded so far by each candidate
+        ggmatrix<uint8_t>     candidatesConfidence; // confidence of each byte of candidatesData, lower is less reliable
+
+        ggvector<int>   stepSpectrumId; // step index stored in each row, -1 if empty
+        ggmatrix<float> stepSpectrumCache;
+
+        RxStats stats; // published to Rx::stats when the analysis of the bank completes
+    };
+
     struct Rx {
         bool receiving = false;
         bool analyzing = false;
+        bool isAnalysisQueued = false; // the recording is complete and waits for the analysis in progress
 
         int nMarkersSuccess     = 0;
         int markerFreqStart     = 0;
@@ -944,12 +1325,11 @@ private:
         int samplesNeeded       = 0;
 
         ggvector<float> fftOut; // complex
-        ggvector<int>   fftWorkI;
-        ggvector<float> fftWorkF;
 
         bool hasNewRxData    = false;
         bool hasNewSpectrum  = false;
         bool hasNewAmplitude = false;
+        bool isSpectrumStale = false; // the spectrum does not correspond to amplitudeAverage yet
 
         Spectrum  spectrum;
         Amplitude amplitude;
@@ -966,16 +1346,53 @@ private:
         // variable-length decoding
         int historyId = 0;
 
-        Amplitude    amplitudeAverage;
+        Amplitude    amplitudeAverage; // fixed-length decoding: the last frame, for the spectrum on demand
+        Amplitude    amplitudeMarker; // amplitudeAverage, reordered for the sparse marker detection
         AmplitudeArr amplitudeHistory;
-        RecordedData amplitudeRecorded;
+        RecordedData amplitudeRecorded; // ring buffer with the last recorded frames
 
-        // fixed-length decoding
-        int historyIdFixed = 0;
+        int nFramesRecorded = 0; // frames recorded since the start of the reception
+
+        RxBank banks[2];
+
+        int bankRecord  = 0; // the bank of the transmission that is being recorded
+        int bankAnalyze = 0; // the bank of the transmission that is being analyzed
+
+        // the candidates share the complex spectrum of each recorded step, restricted to the data bins
+        int stepBinStart = 0;
+        int stepBinCount = 0;
+        int stepHopNext  = 0; // next hop of amplitudeRecorded to push to stepDFT
+
+        SlidingDFT stepDFT;
+
+        // work buffers of each executor worker
+        ggmatrix<float>   stepSpectrumSum;
+        ggmatrix<uint8_t> workRSLength;
+        ggmatrix<uint8_t> workRSData;
+        ggmatrix<uint8_t> workData;
+        ggmatrix<uint8_t> workErasures;
+        ggvector<int>     workDecoded; // index of the first decoded candidate in the analysis order, -1 if none
+        ggvector<RxStats> workStats;   // added to stats after the tasks are done
 
-        ggmatrix<uint8_t> spectrumHistoryFixed;
-        ggvector<uint8_t> detectedBins;
-        ggvector<uint8_t> detectedTones;
+        RxStats stats;
+
+        // fixed-length decoding
+        // each frame is reduced to the loudest tone of each lane (16 bins) of the protocols. For each Tx slot of the
+        // payload, the votes count the frames in which each tone was the loudest - a tone with the majority is detected
+        int historyIdFixed = 0; // next row of tonesHistoryFixed
+
+        ggvector<int>     binsFixed;         // the spectrum bins used by the lanes, in increasing order
+        ggvector<uint8_t> spectrumFixed;     // quantized spectrum of the last frame, only at binsFixed
+        ggvector<int>     laneBinFixed;      // for each lane: position of its first bin in spectrumFixed
+        ggmatrix<uint8_t> tonesHistoryFixed; // loudest tone of each lane, for each of the last frames
+        ggmatrix<uint8_t> votesFixed;        // for each slot: number of frames in which each tone was the loudest
+        ggvector<int8_t>  majorityFixed;     // for each slot: the detected tone, -1 if none
+        ggvector<int>     laneOffsetFixed;   // for each protocol: first lane in tonesHistoryFixed, -1 if not tracked
+        ggvector<int>     slotOffsetFixed;   // for each protocol: first slot in votesFixed
+        ggvector<int>     nDetectedFixed;    // for each protocol: number of detected tones, -1 if the votes are stale
+        ggvector<uint8_t> isChangedFixed;    // for each protocol: the detected tones or their votes changed since the last failed decoding
+        ggvector<uint8_t> confidenceFixed;   // for each byte of the payload: the votes of its less reliable tone
+        ggvector<uint8_t> erasuresFixed;
     } m_rx;
 
     struct Tx {
@@ -992,6 +1409,33 @@ private:
         AmplitudeArr bit1Amplitude;
         AmplitudeArr bit0Amplitude;
 
+        Tones frameTones; // tones of the current frame: 2*bit for bit1Amplitude, 2*bit + 1 for bit0Amplitude
+
+        // the sets of tone templates in bit0Amplitude and bit1Amplitude, one for each distinct protocol key
+        //   a set is computed when it is first used and is never overwritten after that
+        int nTemplateSets = 0;
+        ggvector<int>     templatesFreqStart;
+        ggvector<int>     templatesDataBits;
+        ggvector<int>     templatesRow;       // first row of the set
+        ggvector<uint8_t> templatesReady;
+        ggvector<int>     templatesSharedRow; // first row of the set in the source, -1 if the source does not have it
+
+        const GGWave * templatesSource = nullptr;
+
+        // the templates used by the current transmission
+        AmplitudeArr bit0Templates;
+        AmplitudeArr bit1Templates;
+
+        // the frame that renderFrame() generates next
+        int frameId = 0;
+        int totalDataFrames = 0;
+
+        // samples in outputResampled and the number of them already passed to txRender()
+        int frameSamples = 0;
+        int frameSamplesTaken = 0;
+
+        bool isRenderPrepared = false; // txBegin() prepared the current payload for txRender()
+
         TxRxData    data;
         TxProtocol  protocol;
         TxProtocols protocols;
@@ -1005,7 +1449,8 @@ private:
         Tones tones;
     } m_tx;
 
-    mutable Resampler m_resampler;
+    Resampler m_resamplerInp; // capture sample rate -> operating sample rate
+    Resampler m_resamplerOut; // operating sample rate -> output sample rate
 
     void * m_heap  = nullptr;
     int m_heapSize = 0;
@@ -1,779 +1,620 @@
 #pragma once
 
-/*
-
-The FFT routines below are taken from:
-
-https://www.kurims.kyoto-u.ac.jp/~ooura/fft.html
-
-License
-Copyright Takuya OOURA, 1996-2001
-
-*/
-
-
-/*
-Fast Fourier/Cosine/Sine Transform
-    dimension   :one
-    data length :power of 2
-    decimation  :frequency
-    radix       :4, 2
-    data        :inplace
-    table       :use
-functions
-    rdft: Real Discrete Fourier Transform
-function prototypes
-    void rdft(int, int, float *, int *, float *);
-
-
--------- Real DFT / Inverse of Real DFT --------
-    [definition]
-        <case1> RDFT
-            R[k] = sum_j=0^n-1 a[j]*cos(2*pi*j*k/n), 0<=k<=n/2
-            I[k] = sum_j=0^n-1 a[j]*sin(2*pi*j*k/n), 0<k<n/2
-        <case2> IRDFT (excluding scale)
-            a[k] = (R[0] + R[n/2]*cos(pi*k))/2 +
-                   sum_j=1^n/2-1 R[j]*cos(2*pi*j*k/n) +
-                   sum_j=1^n/2-1 I[j]*sin(2*pi*j*k/n), 0<=k<n
-    [usage]
-        <case1>
-            ip[0] = 0; // first time only
-            rdft(n, 1, a, ip, w);
-        <case2>
-            ip[0] = 0; // first time only
-            rdft(n, -1, a, ip, w);
-    [parameters]
-        n              :data length (int)
-                        n >= 2, n = power of 2
-        a[0...n-1]     :input/output data (float *)
-                        <case1>
-                            output data
-                                a[2*k] = R[k], 0<=k<n/2
-                                a[2*k+1] = I[k], 0<k<n/2
-                                a[1] = R[n/2]
-                        <case2>
-                            input data
-                                a[2*j] = R[j], 0<=j<n/2
-                                a[2*j+1] = I[j], 0<j<n/2
-                                a[1] = R[n/2]
-        ip[0...*]      :work area for bit reversal (int *)
-                        length of ip >= 2+sqrt(n/2)
-                        strictly,
-                        length of ip >=
-                            2+(1<<(int)(log(n/2+0.5)/log(2))/2).
-                        ip[0],ip[1] are pointers of the cos/sin table.
-        w[0...n/2-1]   :cos/sin table (float *)
-                        w[],ip[] are initialized if ip[0] == 0.
-    [remark]
-        Inverse of
-            rdft(n, 1, a, ip, w);
-        is
-            rdft(n, -1, a, ip, w);
-            for (j = 0; j <= n - 1; j++) {
-                a[j] *= 2.0 / n;
-            }
-        .
-
-
-Appendix :
-    The cos/sin table is recalculated when the larger table required.
-    w[] and ip[] are compatible with all routines.
-*/
-
-void rdft(int n, int isgn, float *a, int *ip, float *w)
-{
-    void makewt(int nw, int *ip, float *w);
-    void makect(int nc, int *ip, float *c);
-    void bitrv2(int n, int *ip, float *a);
-    void cftfsub(int n, float *a, float *w);
-    void cftbsub(int n, float *a, float *w);
-    void rftfsub(int n, float *a, int nc, float *c);
-    void rftbsub(int n, float *a, int nc, float *c);
-    int nw, nc;
-    float xi;
-
-    nw = ip[0];
-    if (n > (nw << 2)) {
-        nw = n >> 2;
-        makewt(nw, ip, w);
-    }
-    nc = ip[1];
-    if (n > (nc << 2)) {
-        nc = n >> 2;
-        makect(nc, ip, w + nw);
-    }
-    if (isgn >= 0) {
-        if (n > 4) {
-            bitrv2(n, ip + 2, a);
-            cftfsub(n, a, w);
-            rftfsub(n, a, nc, w + nw);
-        } else if (n == 4) {
-            cftfsub(n, a, w);
-        }
-        xi = a[0] - a[1];
-        a[0] += a[1];
-        a[1] = xi;
-    } else {
-        a[1] = 0.5 * (a[0] - a[1]);
-        a[0] -= a[1];
-        if (n > 4) {
-            rftbsub(n, a, nc, w + nw);
-            bitrv2(n, ip + 2, a);
-            cftbsub(n, a, w);
-        } else if (n == 4) {
-            cftfsub(n, a, w);
-        }
-    }
-}
-
-/* -------- initializing routines -------- */
+//
+// FFT of real values
+//
+// The FFT of N real values is computed as a complex FFT of the N/2 pairs of values, followed by a split step that
+// separates the spectra of the even and the odd values. The complex FFT is a Stockham autosort FFT with radix-4
+// stages (plus one radix-2 stage when log2(N/2) is odd), so there is no bit-reversal pass. The stages ping-pong
+// between the output and a work buffer of N values.
+//
+// Within a stage, the butterflies of each twiddle factor operate on contiguous values. They are processed 2
+// complex values at a time with SSE or NEON, depending on GGWAVE_SSE / GGWAVE_NEON. The first stage, where each
+// butterfly has its own twiddle factor, is vectorized across the butterflies instead.
+//
+// The twiddle factors of all sizes are read from a single quarter-wave cosine table for kFFTMaxSize. It is
+// computed once and never modified, so it is shared by all instances and threads.
+//
+// Output layout (same as Ooura's rdft() that was used before):
+//
+//   dst[2*k + 0] = sum_j src[j]*cos(2*pi*j*k/N), 0 <= k < N/2
+//   dst[2*k + 1] = sum_j src[j]*sin(2*pi*j*k/N), 0 <  k < N/2
+//   dst[1]       = sum_j src[j]*cos(pi*j)       (the real value of bin N/2)
+//
 
 #include <math.h>
+#include <string.h>
 
-void makewt(int nw, int *ip, float *w)
-{
-    void bitrv2(int n, int *ip, float *a);
-    int j, nwh;
-    float delta, x, y;
-
-    ip[0] = nw;
-    ip[1] = 1;
-    if (nw > 2) {
-        nwh = nw >> 1;
-        delta = atan(1.0) / nwh;
-        w[0] = 1;
-        w[1] = 0;
-        w[nwh] = cos(delta * nwh);
-        w[nwh + 1] = w[nwh];
-        if (nwh > 2) {
-            for (j = 2; j < nwh; j += 2) {
-                x = cos(delta * j);
-                y = sin(delta * j);
-                w[j] = x;
-                w[j + 1] = y;
-                w[nw - j] = y;
-                w[nw - j + 1] = x;
-            }
-            bitrv2(nw, ip + 2, w);
+static const int kFFTMaxSize = 4096;
+
+// cos(2*pi*k/kFFTMaxSize) for k in [0, kFFTMaxSize/4]
+struct FFTCosTable {
+    float c[kFFTMaxSize/4 + 1];
+
+    FFTCosTable() {
+        for (int k = 0; k <= kFFTMaxSize/4; ++k) {
+            c[k] = (float) cos(2.0*M_PI*k/kFFTMaxSize);
         }
     }
+};
+
+inline const float * fftCosTable() {
+    static const FFTCosTable table;
+    return table.c;
 }
 
+inline bool fftIsValidSize(int N) {
+    return N >= 2 && N <= kFFTMaxSize && (N & (N - 1)) == 0;
+}
 
-void makect(int nc, int *ip, float *c)
-{
-    int j, nch;
-    float delta;
-
-    ip[1] = nc;
-    if (nc > 1) {
-        nch = nc >> 1;
-        delta = atan(1.0) / nch;
-        c[0] = cos(delta * nch);
-        c[nch] = 0.5 * c[0];
-        for (j = 1; j < nch; j++) {
-            c[j] = 0.5 * cos(delta * j);
-            c[nc - j] = 0.5 * sin(delta * j);
-        }
-    }
+// exp(-2*pi*i*k/kFFTMaxSize) for k in [0, kFFTMaxSize/4]
+inline void fftTwiddle(const float * ct, int k, float & re, float & im) {
+    re =  ct[k];
+    im = -ct[kFFTMaxSize/4 - k];
 }
 
+//
+// 4 floats - 2 complex values
+//
+
+#if defined(GGWAVE_SSE)
+
+typedef __m128 fft_v4;
+
+inline fft_v4 fft_load(const float * p)        { return _mm_loadu_ps(p); }
+inline void   fft_store(float * p, fft_v4 a)   { _mm_storeu_ps(p, a); }
+inline fft_v4 fft_add(fft_v4 a, fft_v4 b)      { return _mm_add_ps(a, b); }
+inline fft_v4 fft_sub(fft_v4 a, fft_v4 b)      { return _mm_sub_ps(a, b); }
+inline fft_v4 fft_mul(fft_v4 a, fft_v4 b)      { return _mm_mul_ps(a, b); }
+inline fft_v4 fft_swap(fft_v4 a)               { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)); }
+inline fft_v4 fft_dupRe(fft_v4 a)              { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 0, 0)); }
+inline fft_v4 fft_dupIm(fft_v4 a)              { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 1, 1)); }
+inline fft_v4 fft_lo(fft_v4 a, fft_v4 b)       { return _mm_movelh_ps(a, b); }
+inline fft_v4 fft_hi(fft_v4 a, fft_v4 b)       { return _mm_movehl_ps(b, a); }
+inline fft_v4 fft_rev(fft_v4 a)                { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)); }
+
+#elif defined(GGWAVE_NEON)
+
+typedef float32x4_t fft_v4;
+
+inline fft_v4 fft_load(const float * p)        { return vld1q_f32(p); }
+inline void   fft_store(float * p, fft_v4 a)   { vst1q_f32(p, a); }
+inline fft_v4 fft_add(fft_v4 a, fft_v4 b)      { return vaddq_f32(a, b); }
+inline fft_v4 fft_sub(fft_v4 a, fft_v4 b)      { return vsubq_f32(a, b); }
+inline fft_v4 fft_mul(fft_v4 a, fft_v4 b)      { return vmulq_f32(a, b); }
+inline fft_v4 fft_swap(fft_v4 a)               { return vrev64q_f32(a); }
+inline fft_v4 fft_dupRe(fft_v4 a)              { return vtrnq_f32(a, a).val[0]; }
+inline fft_v4 fft_dupIm(fft_v4 a)              { return vtrnq_f32(a, a).val[1]; }
+inline fft_v4 fft_lo(fft_v4 a, fft_v4 b)       { return vcombine_f32(vget_low_f32(a),  vget_low_f32(b)); }
+inline fft_v4 fft_hi(fft_v4 a, fft_v4 b)       { return vcombine_f32(vget_high_f32(a), vget_high_f32(b)); }
+inline fft_v4 fft_rev(fft_v4 a)                { return vcombine_f32(vget_high_f32(a), vget_low_f32(a)); }
+
+#else
+
+struct fft_v4 {
+    float v[4];
+};
+
+inline fft_v4 fft_load(const float * p)        { return { { p[0], p[1], p[2], p[3] } }; }
+inline void   fft_store(float * p, fft_v4 a)   { p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3]; }
+inline fft_v4 fft_add(fft_v4 a, fft_v4 b)      { return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+inline fft_v4 fft_sub(fft_v4 a, fft_v4 b)      { return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+inline fft_v4 fft_mul(fft_v4 a, fft_v4 b)      { return { { a.v[0]*b.v[0], a.v[1]*b.v[1], a.v[2]*b.v[2], a.v[3]*b.v[3] } }; }
+inline fft_v4 fft_swap(fft_v4 a)               { return { { a.v[1], a.v[0], a.v[3], a.v[2] } }; }
+inline fft_v4 fft_dupRe(fft_v4 a)              { return { { a.v[0], a.v[0], a.v[2], a.v[2] } }; }
+inline fft_v4 fft_dupIm(fft_v4 a)              { return { { a.v[1], a.v[1], a.v[3], a.v[3] } }; }
+inline fft_v4 fft_lo(fft_v4 a, fft_v4 b)       { return { { a.v[0], a.v[1], b.v[0], b.v[1] } }; }
+inline fft_v4 fft_hi(fft_v4 a, fft_v4 b)       { return { { a.v[2], a.v[3], b.v[2], b.v[3] } }; }
+inline fft_v4 fft_rev(fft_v4 a)                { return { { a.v[2], a.v[3], a.v[0], a.v[1] } }; }
+
+#endif
+
+// (re, im) -> (-re, im)
+inline fft_v4 fft_negRe(fft_v4 a) {
+    static const float kSign[4] = { -1.0f, 1.0f, -1.0f, 1.0f };
+    return fft_mul(a, fft_load(kSign));
+}
 
-/* -------- child routines -------- */
+// (re, im) -> (re, -im)
+inline fft_v4 fft_conj(fft_v4 a) {
+    static const float kSign[4] = { 1.0f, -1.0f, 1.0f, -1.0f };
+    return fft_mul(a, fft_load(kSign));
+}
 
+// complex a*w
+inline fft_v4 fft_cmul(fft_v4 a, fft_v4 w) {
+    return fft_add(fft_mul(a, fft_dupRe(w)), fft_negRe(fft_mul(fft_swap(a), fft_dupIm(w))));
+}
 
-void bitrv2(int n, int *ip, float *a)
-{
-    int j, j1, k, k1, l, m, m2;
-    float xr, xi, yr, yi;
+// complex i*a
+inline fft_v4 fft_mulj(fft_v4 a) {
+    return fft_negRe(fft_swap(a));
+}
 
-    ip[0] = 0;
-    l = n;
-    m = 1;
-    while ((m << 3) < l) {
-        l >>= 1;
-        for (j = 0; j < m; j++) {
-            ip[m + j] = ip[j] + l;
+//
+// Stages of the complex FFT of M values
+//
+//   n - length of the sub-transforms of the stage
+//   s - stride of the sub-transforms, n*s == M
+//
+// The stages transform nFrames frames at once, so the twiddle factors are computed once for all frames.
+// Frame f is read from x + f*xStride and written to y + f*yStride.
+//
+
+// Radix-4 stage - any n and s
+inline void fftRadix4Scalar(int n, int s, const float * x, int xStride, float * y, int yStride, int nFrames, const float * ct) {
+    const int m  = n/4;
+    const int dk = kFFTMaxSize/n;
+
+    for (int p = 0; p < m; ++p) {
+        float w1r, w1i;
+        fftTwiddle(ct, p*dk, w1r, w1i);
+        const float w2r = w1r*w1r - w1i*w1i, w2i = 2.0f*w1r*w1i;
+        const float w3r = w1r*w2r - w1i*w2i, w3i = w1r*w2i + w1i*w2r;
+
+        for (int f = 0; f < nFrames; ++f) {
+            const float * xf = x + f*xStride;
+            float * yf = y + f*yStride;
+
+            for (int q = 0; q < s; ++q) {
+                const float * a = xf + 2*(q + s*(p + 0*m));
+                const float * b = xf + 2*(q + s*(p + 1*m));
+                const float * c = xf + 2*(q + s*(p + 2*m));
+                const float * d = xf + 2*(q + s*(p + 3*m));
+
+                const float apcr = a[0] + c[0], apci = a[1] + c[1];
+                const float amcr = a[0] - c[0], amci = a[1] - c[1];
+                const float bpdr = b[0] + d[0], bpdi = b[1] + d[1];
+                const float jbmdr = d[1] - b[1], jbmdi = b[0] - d[0];
+
+                float * y0 = yf + 2*(q + s*(4*p + 0));
+                float * y1 = yf + 2*(q + s*(4*p + 1));
+                float * y2 = yf + 2*(q + s*(4*p + 2));
+                float * y3 = yf + 2*(q + s*(4*p + 3));
+
+                y0[0] = apcr + bpdr;
+                y0[1] = apci + bpdi;
+
+                const float t1r = amcr - jbmdr, t1i = amci - jbmdi;
+                y1[0] = t1r*w1r - t1i*w1i;
+                y1[1] = t1r*w1i + t1i*w1r;
+
+                const float t2r = apcr - bpdr, t2i = apci - bpdi;
+                y2[0] = t2r*w2r - t2i*w2i;
+                y2[1] = t2r*w2i + t2i*w2r;
+
+                const float t3r = amcr + jbmdr, t3i = amci + jbmdi;
+                y3[0] = t3r*w3r - t3i*w3i;
+                y3[1] = t3r*w3i + t3i*w3r;
+            }
         }
-        m <<= 1;
     }
-    m2 = 2 * m;
-    if ((m << 3) == l) {
-        for (k = 0; k < m; k++) {
-            for (j = 0; j < k; j++) {
-                j1 = 2 * j + ip[k];
-                k1 = 2 * k + ip[j];
-                xr = a[j1];
-                xi = a[j1 + 1];
-                yr = a[k1];
-                yi = a[k1 + 1];
-                a[j1] = yr;
-                a[j1 + 1] = yi;
-                a[k1] = xr;
-                a[k1 + 1] = xi;
-                j1 += m2;
-                k1 += 2 * m2;
-                xr = a[j1];
-                xi = a[j1 + 1];
-                yr = a[k1];
-                yi = a[k1 + 1];
-                a[j1] = yr;
-                a[j1 + 1] = yi;
-                a[k1] = xr;
-                a[k1 + 1] = xi;
-                j1 += m2;
-                k1 -= m2;
-                xr = a[j1];
-                xi = a[j1 + 1];
-                yr = a[k1];
-                yi = a[k1 + 1];
-                a[j1] = yr;
-                a[j1 + 1] = yi;
-                a[k1] = xr;
-                a[k1 + 1] = xi;
-                j1 += m2;
-                k1 += 2 * m2;
-                xr = a[j1];
-                xi = a[j1 + 1];
-                yr = a[k1];
-                yi = a[k1 + 1];
-                a[j1] = yr;
-                a[j1 + 1] = yi;
-                a[k1] = xr;
-                a[k1 + 1] = xi;
-            }
-            j1 = 2 * k + m2 + ip[k];
-            k1 = j1 + m2;
-            xr = a[j1];
-            xi = a[j1 + 1];
-            yr = a[k1];
-            yi = a[k1 + 1];
-            a[j1] = yr;
-            a[j1 + 1] = yi;
-            a[k1] = xr;
-            a[k1 + 1] = xi;
+}
+
+// Radix-4 stage - s == 1, n/4 even. Vectorized across the butterflies
+inline void fftRadix4First(int n, const float * x, int xStride, float * y, int yStride, int nFrames, const float * ct) {
+    const int m  = n/4;
+    const int dk = kFFTMaxSize/n;
+
+    float w[4];
+    for (int p = 0; p < m; p += 2) {
+        fftTwiddle(ct, (p + 0)*dk, w[0], w[1]);
+        fftTwiddle(ct, (p + 1)*dk, w[2], w[3]);
+        const fft_v4 w1 = fft_load(w);
+        const fft_v4 w2 = fft_cmul(w1, w1);
+        const fft_v4 w3 = fft_cmul(w1, w2);
+
+        for (int f = 0; f < nFrames; ++f) {
+            const float * xf = x + f*xStride;
+            float * yf = y + f*yStride;
+
+            const fft_v4 a = fft_load(xf + 2*(p + 0*m));
+            const fft_v4 b = fft_load(xf + 2*(p + 1*m));
+            const fft_v4 c = fft_load(xf + 2*(p + 2*m));
+            const fft_v4 d = fft_load(xf + 2*(p + 3*m));
+
+            const fft_v4 apc  = fft_add(a, c);
+            const fft_v4 amc  = fft_sub(a, c);
+            const fft_v4 bpd  = fft_add(b, d);
+            const fft_v4 jbmd = fft_mulj(fft_sub(b, d));
+
+            const fft_v4 r0 = fft_add(apc, bpd);
+            const fft_v4 r1 = fft_cmul(fft_sub(amc, jbmd), w1);
+            const fft_v4 r2 = fft_cmul(fft_sub(apc, bpd),  w2);
+            const fft_v4 r3 = fft_cmul(fft_add(amc, jbmd), w3);
+
+            fft_store(yf + 2*(4*p + 0), fft_lo(r0, r1));
+            fft_store(yf + 2*(4*p + 2), fft_lo(r2, r3));
+            fft_store(yf + 2*(4*p + 4), fft_hi(r0, r1));
+            fft_store(yf + 2*(4*p + 6), fft_hi(r2, r3));
         }
-    } else {
-        for (k = 1; k < m; k++) {
-            for (j = 0; j < k; j++) {
-                j1 = 2 * j + ip[k];
-                k1 = 2 * k + ip[j];
-                xr = a[j1];
-                xi = a[j1 + 1];
-                yr = a[k1];
-                yi = a[k1 + 1];
-                a[j1] = yr;
-                a[j1 + 1] = yi;
-                a[k1] = xr;
-                a[k1 + 1] = xi;
-                j1 += m2;
-                k1 += m2;
-                xr = a[j1];
-                xi = a[j1 + 1];
-                yr = a[k1];
-                yi = a[k1 + 1];
-                a[j1] = yr;
-                a[j1 + 1] = yi;
-                a[k1] = xr;
-                a[k1 + 1] = xi;
+    }
+}
+
+// Radix-4 stage - s even. Vectorized along the contiguous values of each butterfly
+//
+//   Only the values [q0, q1) of each butterfly are computed. q0 and q1 are even
+//
+inline void fftRadix4(int n, int s, int q0, int q1, const float * x, int xStride, float * y, int yStride, int nFrames, const float * ct) {
+    const int m  = n/4;
+    const int dk = kFFTMaxSize/n;
+
+    float w[4];
+    for (int p = 0; p < m; ++p) {
+        fftTwiddle(ct, p*dk, w[0], w[1]);
+        w[2] = w[0];
+        w[3] = w[1];
+        const fft_v4 w1 = fft_load(w);
+        const fft_v4 w2 = fft_cmul(w1, w1);
+        const fft_v4 w3 = fft_cmul(w1, w2);
+
+        for (int f = 0; f < nFrames; ++f) {
+            const float * xa = x + f*xStride + 2*s*(p + 0*m);
+            const float * xb = x + f*xStride + 2*s*(p + 1*m);
+            const float * xc = x + f*xStride + 2*s*(p + 2*m);
+            const float * xd = x + f*xStride + 2*s*(p + 3*m);
+
+            float * y0 = y + f*yStride + 2*s*(4*p + 0);
+            float * y1 = y + f*yStride + 2*s*(4*p + 1);
+            float * y2 = y + f*yStride + 2*s*(4*p + 2);
+            float * y3 = y + f*yStride + 2*s*(4*p + 3);
+
+            for (int i = 2*q0; i < 2*q1; i += 4) {
+                const fft_v4 a = fft_load(xa + i);
+                const fft_v4 b = fft_load(xb + i);
+                const fft_v4 c = fft_load(xc + i);
+                const fft_v4 d = fft_load(xd + i);
+
+                const fft_v4 apc  = fft_add(a, c);
+                const fft_v4 amc  = fft_sub(a, c);
+                const fft_v4 bpd  = fft_add(b, d);
+                const fft_v4 jbmd = fft_mulj(fft_sub(b, d));
+
+                fft_store(y0 + i, fft_add(apc, bpd));
+                fft_store(y1 + i, fft_cmul(fft_sub(amc, jbmd), w1));
+                fft_store(y2 + i, fft_cmul(fft_sub(apc, bpd),  w2));
+                fft_store(y3 + i, fft_cmul(fft_add(amc, jbmd), w3));
             }
         }
     }
 }
 
+// Radix-2 stage - n == 2, the last stage. Only the values [q0, q1) of each butterfly are computed
+inline void fftRadix2(int s, int q0, int q1, const float * x, int xStride, float * y, int yStride, int nFrames) {
+    for (int f = 0; f < nFrames; ++f) {
+        const float * xa = x + f*xStride;
+        const float * xb = x + f*xStride + 2*s;
 
-void bitrv2conj(int n, int *ip, float *a)
-{
-    int j, j1, k, k1, l, m, m2;
-    float xr, xi, yr, yi;
+        float * y0 = y + f*yStride;
+        float * y1 = y + f*yStride + 2*s;
 
-    ip[0] = 0;
-    l = n;
-    m = 1;
-    while ((m << 3) < l) {
-        l >>= 1;
-        for (j = 0; j < m; j++) {
-            ip[m + j] = ip[j] + l;
-        }
-        m <<= 1;
-    }
-    m2 = 2 * m;
-    if ((m << 3) == l) {
-        for (k = 0; k < m; k++) {
-            for (j = 0; j < k; j++) {
-                j1 = 2 * j + ip[k];
-                k1 = 2 * k + ip[j];
-                xr = a[j1];
-                xi = -a[j1 + 1];
-                yr = a[k1];
-                yi = -a[k1 + 1];
-                a[j1] = yr;
-                a[j1 + 1] = yi;
-                a[k1] = xr;
-                a[k1 + 1] = xi;
-                j1 += m2;
-                k1 += 2 * m2;
-                xr = a[j1];
-                xi = -a[j1 + 1];
-                yr = a[k1];
-                yi = -a[k1 + 1];
-                a[j1] = yr;
-                a[j1 + 1] = yi;
-                a[k1] = xr;
-                a[k1 + 1] = xi;
-                j1 += m2;
-                k1 -= m2;
-                xr = a[j1];
-                xi = -a[j1 + 1];
-                yr = a[k1];
-                yi = -a[k1 + 1];
-                a[j1] = yr;
-                a[j1 + 1] = yi;
-                a[k1] = xr;
-                a[k1 + 1] = xi;
-                j1 += m2;
-                k1 += 2 * m2;
-                xr = a[j1];
-                xi = -a[j1 + 1];
-                yr = a[k1];
-                yi = -a[k1 + 1];
-                a[j1] = yr;
-                a[j1 + 1] = yi;
-                a[k1] = xr;
-                a[k1 + 1] = xi;
-            }
-            k1 = 2 * k + ip[k];
-            a[k1 + 1] = -a[k1 + 1];
-            j1 = k1 + m2;
-            k1 = j1 + m2;
-            xr = a[j1];
-            xi = -a[j1 + 1];
-            yr = a[k1];
-            yi = -a[k1 + 1];
-            a[j1] = yr;
-            a[j1 + 1] = yi;
-            a[k1] = xr;
-            a[k1 + 1] = xi;
-            k1 += m2;
-            a[k1 + 1] = -a[k1 + 1];
+        int i = 2*q0;
+        for (; i + 4 <= 2*q1; i += 4) {
+            const fft_v4 a = fft_load(xa + i);
+            const fft_v4 b = fft_load(xb + i);
+
+            fft_store(y0 + i, fft_add(a, b));
+            fft_store(y1 + i, fft_sub(a, b));
         }
-    } else {
-        a[1] = -a[1];
-        a[m2 + 1] = -a[m2 + 1];
-        for (k = 1; k < m; k++) {
-            for (j = 0; j < k; j++) {
-                j1 = 2 * j + ip[k];
-                k1 = 2 * k + ip[j];
-                xr = a[j1];
-                xi = -a[j1 + 1];
-                yr = a[k1];
-                yi = -a[k1 + 1];
-                a[j1] = yr;
-                a[j1 + 1] = yi;
-                a[k1] = xr;
-                a[k1 + 1] = xi;
-                j1 += m2;
-                k1 += m2;
-                xr = a[j1];
-                xi = -a[j1 + 1];
-                yr = a[k1];
-                yi = -a[k1 + 1];
-                a[j1] = yr;
-                a[j1 + 1] = yi;
-                a[k1] = xr;
-                a[k1 + 1] = xi;
-            }
-            k1 = 2 * k + ip[k];
-            a[k1 + 1] = -a[k1 + 1];
-            a[k1 + m2 + 1] = -a[k1 + m2 + 1];
+        for (; i < 2*q1; ++i) {
+            y0[i] = xa[i] + xb[i];
+            y1[i] = xa[i] - xb[i];
         }
     }
 }
 
+// Split the complex FFT z of the N/2 pairs of real values into the FFT of the N real values, in place - bins 0
+// and N/2
+inline void fftSplitDC(float * z, int zStride, int nFrames) {
+    for (int f = 0; f < nFrames; ++f) {
+        float * zf = z + f*zStride;
 
-void cftfsub(int n, float *a, float *w)
-{
-    void cft1st(int n, float *a, float *w);
-    void cftmdl(int n, int l, float *a, float *w);
-    int j, j1, j2, j3, l;
-    float x0r, x0i, x1r, x1i, x2r, x2i, x3r, x3i;
-
-    l = 2;
-    if (n > 8) {
-        cft1st(n, a, w);
-        l = 8;
-        while ((l << 2) < n) {
-            cftmdl(n, l, a, w);
-            l <<= 2;
-        }
+        const float z0r = zf[0];
+        const float z0i = zf[1];
+        zf[0] = z0r + z0i;
+        zf[1] = z0r - z0i;
     }
-    if ((l << 2) == n) {
-        for (j = 0; j < l; j += 2) {
-            j1 = j + l;
-            j2 = j1 + l;
-            j3 = j2 + l;
-            x0r = a[j] + a[j1];
-            x0i = a[j + 1] + a[j1 + 1];
-            x1r = a[j] - a[j1];
-            x1i = a[j + 1] - a[j1 + 1];
-            x2r = a[j2] + a[j3];
-            x2i = a[j2 + 1] + a[j3 + 1];
-            x3r = a[j2] - a[j3];
-            x3i = a[j2 + 1] - a[j3 + 1];
-            a[j] = x0r + x2r;
-            a[j + 1] = x0i + x2i;
-            a[j2] = x0r - x2r;
-            a[j2 + 1] = x0i - x2i;
-            a[j1] = x1r - x3i;
-            a[j1 + 1] = x1i + x3r;
-            a[j3] = x1r + x3i;
-            a[j3 + 1] = x1i - x3r;
+}
+
+// Split step for the pairs of bins k, M - k with k in [kFirst, kLast], 1 <= kFirst and kLast <= M/2, M = N/2
+inline void fftSplit(int N, int kFirst, int kLast, float * z, int zStride, int nFrames, const float * ct) {
+    const int M  = N/2;
+    const int dk = kFFTMaxSize/N;
+
+    static const float kHalf[4] = { 0.5f, 0.5f, 0.5f, 0.5f };
+    const fft_v4 half = fft_load(kHalf);
+
+    // bins k, k + 1 and M - k - 1, M - k at a time, while the two pairs do not overlap
+    int k = kFirst;
+    float w[4];
+    for (; k + 1 <= kLast && 2*k + 2 < M; k += 2) {
+        fftTwiddle(ct, (k + 0)*dk, w[0], w[1]);
+        fftTwiddle(ct, (k + 1)*dk, w[2], w[3]);
+        const fft_v4 wk = fft_load(w);
+
+        for (int f = 0; f < nFrames; ++f) {
+            float * zk = z + f*zStride + 2*k;
+            float * zj = z + f*zStride + 2*(M - k - 1);
+
+            const fft_v4 a = fft_load(zk);
+            const fft_v4 b = fft_conj(fft_rev(fft_load(zj)));
+
+            // even and odd parts
+            const fft_v4 e = fft_mul(half, fft_add(a, b));
+            const fft_v4 o = fft_mul(half, fft_sub(a, b));
+
+            const fft_v4 jp = fft_mulj(fft_cmul(o, wk));
+
+            // the imaginary parts are stored with the opposite sign
+            fft_store(zk, fft_conj(fft_sub(e, jp)));
+            fft_store(zj, fft_rev(fft_add(e, jp)));
         }
-    } else {
-        for (j = 0; j < l; j += 2) {
-            j1 = j + l;
-            x0r = a[j] - a[j1];
-            x0i = a[j + 1] - a[j1 + 1];
-            a[j] += a[j1];
-            a[j + 1] += a[j1 + 1];
-            a[j1] = x0r;
-            a[j1 + 1] = x0i;
+    }
+
+    for (; k <= kLast; ++k) {
+        float wr, wi;
+        fftTwiddle(ct, k*dk, wr, wi);
+
+        for (int f = 0; f < nFrames; ++f) {
+            float * zk = z + f*zStride + 2*k;
+            float * zj = z + f*zStride + 2*(M - k);
+
+            const float er = 0.5f*(zk[0] + zj[0]), ei = 0.5f*(zk[1] - zj[1]);
+            const float orr = 0.5f*(zk[0] - zj[0]), oi = 0.5f*(zk[1] + zj[1]);
+
+            const float pr = wr*orr - wi*oi;
+            const float pi = wr*oi  + wi*orr;
+
+            zj[0] = er - pi;
+            zj[1] = ei + pr;
+            zk[0] = er + pi;
+            zk[1] = pr - ei;
         }
     }
 }
 
+// The parts of the last stage and of the split step that are needed for the bins [kBegin, kEnd) of an FFT of
+// size N. Everything else is skipped
+struct FFTBand {
+    // pairs [first, last] of the split step, not overlapping
+    int nSplit;
+    int split[2][2];
+
+    // values [begin, end) of each butterfly of the last stage
+    int nLast;
+    int last[9][2];
+};
+
+inline void fftBandInit(int N, int kBegin, int kEnd, FFTBand & band) {
+    const int M = N/2;
+
+    // stride of the last stage
+    int n = M;
+    int s = 1;
+    for (; n >= 4; n /= 4) {
+        s *= 4;
+    }
+    if (n == 1) {
+        s /= 4;
+    }
+
+    // bin k comes from the pair min(k, M - k)
+    band.nSplit = 0;
+    int a0 = kBegin > 1 ? kBegin : 1;
+    int b0 = kEnd - 1 < M/2 ? kEnd - 1 : M/2;
+    int a1 = M - kEnd + 1 > 1 ? M - kEnd + 1 : 1;
+    int b1 = M - kBegin < M/2 ? M - kBegin : M/2;
+    if (a0 <= b0 && a1 <= b1 && a1 <= b0 + 1 && a0 <= b1 + 1) {
+        a0 = a0 < a1 ? a0 : a1;
+        b0 = b0 > b1 ? b0 : b1;
+        a1 = 1;
+        b1 = 0;
+    }
+    if (a0 <= b0) {
+        band.split[band.nSplit][0] = a0;
+        band.split[band.nSplit][1] = b0;
+        ++band.nSplit;
+    }
+    if (a1 <= b1) {
+        band.split[band.nSplit][0] = a1;
+        band.split[band.nSplit][1] = b1;
+        ++band.nSplit;
+    }
+
+    band.nLast = 0;
+    if (s < 2) {
+        band.last[band.nLast][0] = 0;
+        band.last[band.nLast][1] = s;
+        ++band.nLast;
+        return;
+    }
 
-void cftbsub(int n, float *a, float *w)
-{
-    void cft1st(int n, float *a, float *w);
-    void cftmdl(int n, int l, float *a, float *w);
-    int j, j1, j2, j3, l;
-    float x0r, x0i, x1r, x1i, x2r, x2i, x3r, x3i;
-
-    l = 2;
-    if (n > 8) {
-        cft1st(n, a, w);
-        l = 8;
-        while ((l << 2) < n) {
-            cftmdl(n, l, a, w);
-            l <<= 2;
+    // the pairs [a, b] use the values [a, b] and [M - b, M - a] of the complex FFT, which come from the values
+    // q = k % s of the last stage. Bin 0 uses the value 0
+    int z[5][2] = { { 0, 1 } };
+    int nz = 1;
+    for (int i = 0; i < band.nSplit; ++i) {
+        z[nz][0] = band.split[i][0];
+        z[nz][1] = band.split[i][1] + 1;
+        ++nz;
+        z[nz][0] = M - band.split[i][1];
+        z[nz][1] = M - band.split[i][0] + 1;
+        ++nz;
+    }
+
+    for (int i = 0; i < nz; ++i) {
+        int q0 = z[i][0] % s;
+        int q1 = q0 + z[i][1] - z[i][0];
+        if (z[i][1] - z[i][0] >= s) {
+            q0 = 0;
+            q1 = s;
+        } else if (q1 > s) {
+            band.last[band.nLast][0] = 0;
+            band.last[band.nLast][1] = q1 - s;
+            ++band.nLast;
+            q1 = s;
         }
+        band.last[band.nLast][0] = q0;
+        band.last[band.nLast][1] = q1;
+        ++band.nLast;
     }
-    if ((l << 2) == n) {
-        for (j = 0; j < l; j += 2) {
-            j1 = j + l;
-            j2 = j1 + l;
-            j3 = j2 + l;
-            x0r = a[j] + a[j1];
-            x0i = -a[j + 1] - a[j1 + 1];
-            x1r = a[j] - a[j1];
-            x1i = -a[j + 1] + a[j1 + 1];
-            x2r = a[j2] + a[j3];
-            x2i = a[j2 + 1] + a[j3 + 1];
-            x3r = a[j2] - a[j3];
-            x3i = a[j2 + 1] - a[j3 + 1];
-            a[j] = x0r + x2r;
-            a[j + 1] = x0i - x2i;
-            a[j2] = x0r - x2r;
-            a[j2 + 1] = x0i + x2i;
-            a[j1] = x1r - x3i;
-            a[j1 + 1] = x1i - x3r;
-            a[j3] = x1r + x3i;
-            a[j3 + 1] = x1i + x3r;
+
+    // even, for the vectorized stages
+    for (int i = 0; i < band.nLast; ++i) {
+        band.last[i][0] &= ~1;
+        band.last[i][1] += band.last[i][1] & 1;
+    }
+
+    // sort and merge the overlapping ranges, so that no butterfly is computed twice
+    for (int i = 1; i < band.nLast; ++i) {
+        for (int j = i; j > 0 && band.last[j][0] < band.last[j - 1][0]; --j) {
+            const int b = band.last[j][0];
+            const int e = band.last[j][1];
+            band.last[j][0] = band.last[j - 1][0];
+            band.last[j][1] = band.last[j - 1][1];
+            band.last[j - 1][0] = b;
+            band.last[j - 1][1] = e;
         }
-    } else {
-        for (j = 0; j < l; j += 2) {
-            j1 = j + l;
-            x0r = a[j] - a[j1];
-            x0i = -a[j + 1] + a[j1 + 1];
-            a[j] += a[j1];
-            a[j + 1] = -a[j + 1] - a[j1 + 1];
-            a[j1] = x0r;
-            a[j1 + 1] = x0i;
+    }
+
+    int nLast = 1;
+    for (int i = 1; i < band.nLast; ++i) {
+        if (band.last[i][0] <= band.last[nLast - 1][1]) {
+            band.last[nLast - 1][1] = band.last[i][1] > band.last[nLast - 1][1] ? band.last[i][1] : band.last[nLast - 1][1];
+        } else {
+            band.last[nLast][0] = band.last[i][0];
+            band.last[nLast][1] = band.last[i][1];
+            ++nLast;
         }
     }
+    band.nLast = nLast;
 }
 
-
-void cft1st(int n, float *a, float *w)
-{
-    int j, k1, k2;
-    float wk1r, wk1i, wk2r, wk2i, wk3r, wk3i;
-    float x0r, x0i, x1r, x1i, x2r, x2i, x3r, x3i;
-
-    x0r = a[0] + a[2];
-    x0i = a[1] + a[3];
-    x1r = a[0] - a[2];
-    x1i = a[1] - a[3];
-    x2r = a[4] + a[6];
-    x2i = a[5] + a[7];
-    x3r = a[4] - a[6];
-    x3i = a[5] - a[7];
-    a[0] = x0r + x2r;
-    a[1] = x0i + x2i;
-    a[4] = x0r - x2r;
-    a[5] = x0i - x2i;
-    a[2] = x1r - x3i;
-    a[3] = x1i + x3r;
-    a[6] = x1r + x3i;
-    a[7] = x1i - x3r;
-    wk1r = w[2];
-    x0r = a[8] + a[10];
-    x0i = a[9] + a[11];
-    x1r = a[8] - a[10];
-    x1i = a[9] - a[11];
-    x2r = a[12] + a[14];
-    x2i = a[13] + a[15];
-    x3r = a[12] - a[14];
-    x3i = a[13] - a[15];
-    a[8] = x0r + x2r;
-    a[9] = x0i + x2i;
-    a[12] = x2i - x0i;
-    a[13] = x0r - x2r;
-    x0r = x1r - x3i;
-    x0i = x1i + x3r;
-    a[10] = wk1r * (x0r - x0i);
-    a[11] = wk1r * (x0r + x0i);
-    x0r = x3i + x1r;
-    x0i = x3r - x1i;
-    a[14] = wk1r * (x0i - x0r);
-    a[15] = wk1r * (x0i + x0r);
-    k1 = 0;
-    for (j = 16; j < n; j += 16) {
-        k1 += 2;
-        k2 = 2 * k1;
-        wk2r = w[k1];
-        wk2i = w[k1 + 1];
-        wk1r = w[k2];
-        wk1i = w[k2 + 1];
-        wk3r = wk1r - 2 * wk2i * wk1i;
-        wk3i = 2 * wk2i * wk1r - wk1i;
-        x0r = a[j] + a[j + 2];
-        x0i = a[j + 1] + a[j + 3];
-        x1r = a[j] - a[j + 2];
-        x1i = a[j + 1] - a[j + 3];
-        x2r = a[j + 4] + a[j + 6];
-        x2i = a[j + 5] + a[j + 7];
-        x3r = a[j + 4] - a[j + 6];
-        x3i = a[j + 5] - a[j + 7];
-        a[j] = x0r + x2r;
-        a[j + 1] = x0i + x2i;
-        x0r -= x2r;
-        x0i -= x2i;
-        a[j + 4] = wk2r * x0r - wk2i * x0i;
-        a[j + 5] = wk2r * x0i + wk2i * x0r;
-        x0r = x1r - x3i;
-        x0i = x1i + x3r;
-        a[j + 2] = wk1r * x0r - wk1i * x0i;
-        a[j + 3] = wk1r * x0i + wk1i * x0r;
-        x0r = x1r + x3i;
-        x0i = x1i - x3r;
-        a[j + 6] = wk3r * x0r - wk3i * x0i;
-        a[j + 7] = wk3r * x0i + wk3i * x0r;
-        wk1r = w[k2 + 2];
-        wk1i = w[k2 + 3];
-        wk3r = wk1r - 2 * wk2r * wk1i;
-        wk3i = 2 * wk2r * wk1r - wk1i;
-        x0r = a[j + 8] + a[j + 10];
-        x0i = a[j + 9] + a[j + 11];
-        x1r = a[j + 8] - a[j + 10];
-        x1i = a[j + 9] - a[j + 11];
-        x2r = a[j + 12] + a[j + 14];
-        x2i = a[j + 13] + a[j + 15];
-        x3r = a[j + 12] - a[j + 14];
-        x3i = a[j + 13] - a[j + 15];
-        a[j + 8] = x0r + x2r;
-        a[j + 9] = x0i + x2i;
-        x0r -= x2r;
-        x0i -= x2i;
-        a[j + 12] = -wk2i * x0r - wk2r * x0i;
-        a[j + 13] = -wk2i * x0i + wk2r * x0r;
-        x0r = x1r - x3i;
-        x0i = x1i + x3r;
-        a[j + 10] = wk1r * x0r - wk1i * x0i;
-        a[j + 11] = wk1r * x0i + wk1i * x0r;
-        x0r = x1r + x3i;
-        x0i = x1i - x3r;
-        a[j + 14] = wk3r * x0r - wk3i * x0i;
-        a[j + 15] = wk3r * x0i + wk3i * x0r;
+// FFT of nFrames frames of N real values
+//
+//   N         - power of 2 in [2, kFFTMaxSize]
+//   src       - frame f is src + f*srcStride, N values
+//   dst       - frame f is dst + f*dstStride, N values
+//   work      - frame f is work + f*dstStride, N values
+//
+//   band      - if not null, only the bins of the band are computed. The rest of dst is undefined
+//
+//   With a single frame, dst can be equal to src. Otherwise, src must not overlap dst and work.
+//
+inline void fftrFrames(int N, int nFrames, const float * src, int srcStride, float * dst, float * work, int dstStride,
+                       const FFTBand * band = nullptr) {
+    const float * ct = fftCosTable();
+
+    const int M = N/2;
+
+    int nStages = 0;
+    for (int n = M; n > 1; n /= 4) {
+        ++nStages;
     }
-}
 
+    // the last stage writes to dst
+    const float * x = src;
+    float * y = nStages % 2 == 1 ? dst : work;
+
+    int xStride = srcStride;
 
-void cftmdl(int n, int l, float *a, float *w)
-{
-    int j, j1, j2, j3, k, k1, k2, m, m2;
-    float wk1r, wk1i, wk2r, wk2i, wk3r, wk3i;
-    float x0r, x0i, x1r, x1i, x2r, x2i, x3r, x3i;
-
-    m = l << 2;
-    for (j = 0; j < l; j += 2) {
-        j1 = j + l;
-        j2 = j1 + l;
-        j3 = j2 + l;
-        x0r = a[j] + a[j1];
-        x0i = a[j + 1] + a[j1 + 1];
-        x1r = a[j] - a[j1];
-        x1i = a[j + 1] - a[j1 + 1];
-        x2r = a[j2] + a[j3];
-        x2i = a[j2 + 1] + a[j3 + 1];
-        x3r = a[j2] - a[j3];
-        x3i = a[j2 + 1] - a[j3 + 1];
-        a[j] = x0r + x2r;
-        a[j + 1] = x0i + x2i;
-        a[j2] = x0r - x2r;
-        a[j2 + 1] = x0i - x2i;
-        a[j1] = x1r - x3i;
-        a[j1 + 1] = x1i + x3r;
-        a[j3] = x1r + x3i;
-        a[j3 + 1] = x1i - x3r;
+    if (nStages == 0) {
+        for (int f = 0; f < nFrames; ++f) {
+            memmove(dst + f*dstStride, src + f*srcStride, N*sizeof(float));
+        }
+    } else if (x == y) {
+        memcpy(work, src, N*sizeof(float));
+        x = work;
     }
-    wk1r = w[2];
-    for (j = m; j < l + m; j += 2) {
-        j1 = j + l;
-        j2 = j1 + l;
-        j3 = j2 + l;
-        x0r = a[j] + a[j1];
-        x0i = a[j + 1] + a[j1 + 1];
-        x1r = a[j] - a[j1];
-        x1i = a[j + 1] - a[j1 + 1];
-        x2r = a[j2] + a[j3];
-        x2i = a[j2 + 1] + a[j3 + 1];
-        x3r = a[j2] - a[j3];
-        x3i = a[j2 + 1] - a[j3 + 1];
-        a[j] = x0r + x2r;
-        a[j + 1] = x0i + x2i;
-        a[j2] = x2i - x0i;
-        a[j2 + 1] = x0r - x2r;
-        x0r = x1r - x3i;
-        x0i = x1i + x3r;
-        a[j1] = wk1r * (x0r - x0i);
-        a[j1 + 1] = wk1r * (x0r + x0i);
-        x0r = x3i + x1r;
-        x0i = x3r - x1i;
-        a[j3] = wk1r * (x0i - x0r);
-        a[j3 + 1] = wk1r * (x0i + x0r);
+
+    int n = M;
+    int s = 1;
+    for (; n >= 4; n /= 4, s *= 4) {
+        if (s > 1 && band && n == 4) {
+            for (int i = 0; i < band->nLast; ++i) {
+                fftRadix4(n, s, band->last[i][0], band->last[i][1], x, xStride, y, dstStride, nFrames, ct);
+            }
+        } else if (s > 1) {
+            fftRadix4(n, s, 0, s, x, xStride, y, dstStride, nFrames, ct);
+        } else if (n >= 8) {
+            fftRadix4First(n, x, xStride, y, dstStride, nFrames, ct);
+        } else {
+            fftRadix4Scalar(n, s, x, xStride, y, dstStride, nFrames, ct);
+        }
+
+        x = y;
+        y = y == dst ? work : dst;
+        xStride = dstStride;
     }
-    k1 = 0;
-    m2 = 2 * m;
-    for (k = m2; k < n; k += m2) {
-        k1 += 2;
-        k2 = 2 * k1;
-        wk2r = w[k1];
-        wk2i = w[k1 + 1];
-        wk1r = w[k2];
-        wk1i = w[k2 + 1];
-        wk3r = wk1r - 2 * wk2i * wk1i;
-        wk3i = 2 * wk2i * wk1r - wk1i;
-        for (j = k; j < l + k; j += 2) {
-            j1 = j + l;
-            j2 = j1 + l;
-            j3 = j2 + l;
-            x0r = a[j] + a[j1];
-            x0i = a[j + 1] + a[j1 + 1];
-            x1r = a[j] - a[j1];
-            x1i = a[j + 1] - a[j1 + 1];
-            x2r = a[j2] + a[j3];
-            x2i = a[j2 + 1] + a[j3 + 1];
-            x3r = a[j2] - a[j3];
-            x3i = a[j2 + 1] - a[j3 + 1];
-            a[j] = x0r + x2r;
-            a[j + 1] = x0i + x2i;
-            x0r -= x2r;
-            x0i -= x2i;
-            a[j2] = wk2r * x0r - wk2i * x0i;
-            a[j2 + 1] = wk2r * x0i + wk2i * x0r;
-            x0r = x1r - x3i;
-            x0i = x1i + x3r;
-            a[j1] = wk1r * x0r - wk1i * x0i;
-            a[j1 + 1] = wk1r * x0i + wk1i * x0r;
-            x0r = x1r + x3i;
-            x0i = x1i - x3r;
-            a[j3] = wk3r * x0r - wk3i * x0i;
-            a[j3 + 1] = wk3r * x0i + wk3i * x0r;
+
+    if (n == 2 && band) {
+        for (int i = 0; i < band->nLast; ++i) {
+            fftRadix2(s, band->last[i][0], band->last[i][1], x, xStride, y, dstStride, nFrames);
         }
-        wk1r = w[k2 + 2];
-        wk1i = w[k2 + 3];
-        wk3r = wk1r - 2 * wk2r * wk1i;
-        wk3i = 2 * wk2r * wk1r - wk1i;
-        for (j = k + m; j < l + (k + m); j += 2) {
-            j1 = j + l;
-            j2 = j1 + l;
-            j3 = j2 + l;
-            x0r = a[j] + a[j1];
-            x0i = a[j + 1] + a[j1 + 1];
-            x1r = a[j] - a[j1];
-            x1i = a[j + 1] - a[j1 + 1];
-            x2r = a[j2] + a[j3];
-            x2i = a[j2 + 1] + a[j3 + 1];
-            x3r = a[j2] - a[j3];
-            x3i = a[j2 + 1] - a[j3 + 1];
-            a[j] = x0r + x2r;
-            a[j + 1] = x0i + x2i;
-            x0r -= x2r;
-            x0i -= x2i;
-            a[j2] = -wk2i * x0r - wk2r * x0i;
-            a[j2 + 1] = -wk2i * x0i + wk2r * x0r;
-            x0r = x1r - x3i;
-            x0i = x1i + x3r;
-            a[j1] = wk1r * x0r - wk1i * x0i;
-            a[j1 + 1] = wk1r * x0i + wk1i * x0r;
-            x0r = x1r + x3i;
-            x0i = x1i - x3r;
-            a[j3] = wk3r * x0r - wk3i * x0i;
-            a[j3 + 1] = wk3r * x0i + wk3i * x0r;
+    } else if (n == 2) {
+        fftRadix2(s, 0, s, x, xStride, y, dstStride, nFrames);
+    }
+
+    fftSplitDC(dst, dstStride, nFrames);
+
+    if (band) {
+        for (int i = 0; i < band->nSplit; ++i) {
+            fftSplit(N, band->split[i][0], band->split[i][1], dst, dstStride, nFrames, ct);
         }
+    } else if (M > 1) {
+        fftSplit(N, 1, M/2, dst, dstStride, nFrames, ct);
     }
 }
 
+// FFT of N real values
+//
+//   N    - power of 2 in [2, kFFTMaxSize]
+//   src  - N values
+//   dst  - N values, can be equal to src
+//   work - N values
+//
+inline void fftr(int N, const float * src, float * dst, float * work) {
+    fftrFrames(N, 1, src, 0, dst, work, 0);
+}
 
-void rftfsub(int n, float *a, int nc, float *c)
-{
-    int j, k, kk, ks, m;
-    float wkr, wki, xr, xi, yr, yi;
-
-    m = n >> 1;
-    ks = 2 * nc / m;
-    kk = 0;
-    for (j = 2; j < m; j += 2) {
-        k = n - j;
-        kk += ks;
-        wkr = 0.5 - c[nc - kk];
-        wki = c[kk];
-        xr = a[j] - a[k];
-        xi = a[j + 1] + a[k + 1];
-        yr = wkr * xr - wki * xi;
-        yi = wkr * xi + wki * xr;
-        a[j] -= yr;
-        a[j + 1] -= yi;
-        a[k] += yr;
-        a[k + 1] -= yi;
-    }
+// FFT of N real values, computing only the bins [kBegin, kEnd), 0 <= kBegin < kEnd <= N/2
+//
+//   Same as fftr(), but the butterflies of the last stage and the split step that do not contribute to the band
+//   are skipped. The other bins in dst are undefined
+//
+inline void fftrBand(int N, const float * src, float * dst, float * work, int kBegin, int kEnd) {
+    FFTBand band;
+    fftBandInit(N, kBegin, kEnd, band);
+
+    fftrFrames(N, 1, src, 0, dst, work, 0, &band);
 }
 
+// FFT of nFrames frames of N real values
+//
+//   src - frame f is src + f*srcStride, N values. Must not overlap dst
+//   dst - frame f is dst + 2*f*N, 2*N values. The second half of each frame is used as work buffer and is
+//         zero on return
+//
+//   Small frames are transformed in groups of kFFTMaxSize values, which stay in the cache during all stages, and
+//   the twiddle factors are computed once per group. From kFFTBatchMaxSize, where the twiddle factors are a small
+//   part of the work, the frames are transformed one by one.
+//
+static const int kFFTBatchMaxSize = 1024;
+
+inline void fftrBatch(int N, int nFrames, const float * src, int srcStride, float * dst) {
+    const int groupSize = N < kFFTBatchMaxSize ? kFFTMaxSize/N : 1;
+
+    for (int f = 0; f < nFrames; f += groupSize) {
+        const int n = nFrames - f < groupSize ? nFrames - f : groupSize;
+        if (n == 1) {
+            fftr(N, src + f*srcStride, dst + 2*f*N, dst + 2*f*N + N);
+        } else {
+            fftrFrames(N, n, src + f*srcStride, srcStride, dst + 2*f*N, dst + 2*f*N + N, 2*N);
+        }
 
-void rftbsub(int n, float *a, int nc, float *c)
-{
-    int j, k, kk, ks, m;
-    float wkr, wki, xr, xi, yr, yi;
-
-    a[1] = -a[1];
-    m = n >> 1;
-    ks = 2 * nc / m;
-    kk = 0;
-    for (j = 2; j < m; j += 2) {
-        k = n - j;
-        kk += ks;
-        wkr = 0.5 - c[nc - kk];
-        wki = c[kk];
-        xr = a[j] - a[k];
-        xi = a[j + 1] + a[k + 1];
-        yr = wkr * xr + wki * xi;
-        yi = wkr * xi - wki * xr;
-        a[j] -= yr;
-        a[j + 1] = yi - a[j + 1];
-        a[k] += yr;
-        a[k + 1] = yi - a[k + 1];
+        // while the group is still in the cache
+        for (int i = f; i < f + n; ++i) {
+            memset(dst + 2*i*N + N, 0, N*sizeof(float));
+        }
     }
-    a[m + 1] = -a[m + 1];
 }
@@ -4,17 +4,33 @@
 #define PROGMEM
 #endif
 
-#include "fft.h"
 #include "reed-solomon/rs.hpp"
 
 #include <math.h>
 #include <stdio.h>
 //#include <random>
 
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <atomic>
+#include <chrono>
+#endif
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define GGWAVE_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#define GGWAVE_NEON
+#include <arm_neon.h>
+#endif
+
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+#include "fft.h"
+
 #ifdef GGWAVE_DISABLE_LOG
 #define ggprintf(...)
 #else
@@ -38,10 +54,6 @@ namespace {
 FILE * g_fptr = stderr;
 GGWave * g_instances[GGWAVE_MAX_INSTANCES];
 
-double linear_interp(double first_number, double second_number, double fraction) {
-    return (first_number + ((second_number - first_number)*fraction));
-}
-
 }
 
 extern "C"
@@ -134,6 +146,93 @@ int ggwave_encode(
     return nBytes;
 }
 
+extern "C"
+int ggwave_nencode(
+        ggwave_Instance id,
+        const void * payloadBuffer,
+        int payloadSize,
+        ggwave_ProtocolId protocolId,
+        int volume,
+        void * waveformBuffer,
+        int waveformSize) {
+    GGWave * ggWave = (GGWave *) g_instances[id];
+
+    if (ggWave == nullptr) {
+        ggprintf("Invalid GGWave instance %d\n", id);
+        return -1;
+    }
+
+    if (ggWave->init(payloadSize, (const char *) payloadBuffer, protocolId, volume) == false) {
+        ggprintf("Failed to initialize Tx transmission for GGWave instance %d\n", id);
+        return -1;
+    }
+
+    const int nBytes = ggWave->encodeSize_bytes();
+    if (nBytes == 0) {
+        ggprintf("Failed to encode data - GGWave instance %d\n", id);
+        return -1;
+    }
+
+    if (waveformBuffer == nullptr) {
+        return nBytes;
+    }
+
+    if (waveformSize < nBytes) {
+        ggprintf("Failed to encode data - waveformBuffer is too small: %d < %d\n", waveformSize, nBytes);
+        return -2;
+    }
+
+    if (ggWave->txBegin() == false) {
+        ggprintf("Failed to encode data - GGWave instance %d\n", id);
+        return -1;
+    }
+
+    return ggWave->txRender(waveformBuffer, nBytes/ggWave->sampleSizeOut())*ggWave->sampleSizeOut();
+}
+
+extern "C"
+int ggwave_txBegin(
+        ggwave_Instance id,
+        const void * payloadBuffer,
+        int payloadSize,
+        ggwave_ProtocolId protocolId,
+        int volume) {
+    GGWave * ggWave = (GGWave *) g_instances[id];
+
+    if (ggWave == nullptr) {
+        ggprintf("Invalid GGWave instance %d\n", id);
+        return -1;
+    }
+
+    if (ggWave->init(payloadSize, (const char *) payloadBuffer, protocolId, volume) == false) {
+        ggprintf("Failed to initialize Tx transmission for GGWave instance %d\n", id);
+        return -1;
+    }
+
+    const int nBytes = ggWave->encodeSize_bytes();
+    if (nBytes == 0 || ggWave->txBegin() == false) {
+        ggprintf("Failed to encode data - GGWave instance %d\n", id);
+        return -1;
+    }
+
+    return nBytes;
+}
+
+extern "C"
+int ggwave_txRender(
+        ggwave_Instance id,
+        void * waveformBuffer,
+        int waveformSize) {
+    GGWave * ggWave = (GGWave *) g_instances[id];
+
+    if (ggWave == nullptr) {
+        ggprintf("Invalid GGWave instance %d\n", id);
+        return -1;
+    }
+
+    return ggWave->txRender(waveformBuffer, waveformSize/ggWave->sampleSizeOut())*ggWave->sampleSizeOut();
+}
+
 extern "C"
 int ggwave_decode(
         ggwave_Instance id,
@@ -248,14 +347,17 @@ uint8_t getDSSMagic(int i) {
 #endif
 }
 
-void FFT(float * f, int N, int * wi, float * wf) {
-    rdft(N, 1, f, wi, wf);
-}
+static_assert(GGWave::kMaxSamplesPerFrame <= kFFTMaxSize, "The FFT tables are too small for kMaxSamplesPerFrame");
+
+// dst has space for 2*N values. The second half is used as work buffer and is zero on return
+void FFT(const float * src, float * dst, int N) {
+    fftr(N, src, dst, dst + N);
 
-void FFT(const float * src, float * dst, int N, int * wi, float * wf) {
-    memcpy(dst, src, N * sizeof(float));
+    memset(dst + N, 0, N*sizeof(float));
+}
 
-    FFT(dst, N, wi, wf);
+void FFTBatch(const float * src, float * dst, int N, int count, int stride) {
+    fftrBatch(N, count, src, stride, dst);
 }
 
 inline void addAmplitudeSmooth(
@@ -281,10 +383,287 @@ inline void addAmplitudeSmooth(
     }
 }
 
+// Convert 32-bit float samples to the output sample format
+inline void convertOutput(const float * src, int n, GGWave::SampleFormat format, void * dst) {
+    switch (format) {
+        case GGWAVE_SAMPLE_FORMAT_UNDEFINED: break;
+        case GGWAVE_SAMPLE_FORMAT_U8:
+            {
+                auto p = reinterpret_cast<uint8_t *>(dst);
+                for (int i = 0; i < n; ++i) {
+                    p[i] = 128*(src[i] + 1.0f);
+                }
+            } break;
+        case GGWAVE_SAMPLE_FORMAT_I8:
+            {
+                auto p = reinterpret_cast<uint8_t *>(dst);
+                for (int i = 0; i < n; ++i) {
+                    p[i] = 128*src[i];
+                }
+            } break;
+        case GGWAVE_SAMPLE_FORMAT_U16:
+            {
+                auto p = reinterpret_cast<uint16_t *>(dst);
+                for (int i = 0; i < n; ++i) {
+                    p[i] = 32768*(src[i] + 1.0f);
+                }
+            } break;
+        case GGWAVE_SAMPLE_FORMAT_I16:
+            {
+                auto p = reinterpret_cast<int16_t *>(dst);
+                for (int i = 0; i < n; ++i) {
+                    p[i] = 32768*src[i];
+                }
+            } break;
+        case GGWAVE_SAMPLE_FORMAT_F32:
+            {
+                auto p = reinterpret_cast<float *>(dst);
+                for (int i = 0; i < n; ++i) {
+                    p[i] = src[i];
+                }
+            } break;
+    }
+}
+
+// number of consecutive samples that generateTonesSmooth() computes at a time
+constexpr int kToneLanes = 8;
+
+// Same as calling addAmplitudeSmooth() with the waveform of each tone, on a zeroed dst
+//
+//   A tone is 2*bit + 0 for the bit1 waveform and 2*bit + 1 for the bit0 waveform of the protocol. Each waveform has
+//   an integer number of periods per frame, so it is generated with a complex rotator, starting from the phase of the
+//   bit. The lanes compute kToneLanes consecutive samples, so the inner loop can be vectorized.
+inline void generateTonesSmooth(
+        const GGWave::Tone * tones, int nTones, int freqStart, int nDataBitsPerTx,
+        GGWave::Amplitude & dst,
+        float scalar, int finalId, int cycleMod, int nPerCycle) {
+    float re[kToneLanes];
+    float im[kToneLanes];
+
+    const int nLanesEnd = (finalId/kToneLanes)*kToneLanes;
+
+    for (int t = 0; t < nTones; ++t) {
+        const double phase = (M_PI*(tones[t]/2))/nDataBitsPerTx;
+        const double omega = (2.0*M_PI*(freqStart + tones[t]))/finalId;
+
+        const float rotRe = cos(omega);
+        const float rotIm = sin(omega);
+
+        re[0] = cos(phase);
+        im[0] = sin(phase);
+        for (int l = 1; l < kToneLanes; ++l) {
+            re[l] = re[l - 1]*rotRe - im[l - 1]*rotIm;
+            im[l] = re[l - 1]*rotIm + im[l - 1]*rotRe;
+        }
+
+        // advance all lanes by kToneLanes samples
+        const float stepRe = cos(kToneLanes*omega);
+        const float stepIm = sin(kToneLanes*omega);
+
+        for (int i = 0; i < nLanesEnd; i += kToneLanes) {
+            for (int l = 0; l < kToneLanes; ++l) {
+                dst[i + l] += im[l];
+
+                const float tmp = re[l]*stepRe - im[l]*stepIm;
+                im[l] = re[l]*stepIm + im[l]*stepRe;
+                re[l] = tmp;
+            }
+        }
+
+        for (int i = nLanesEnd; i < finalId; ++i) {
+            dst[i] += sin(omega*i + phase);
+        }
+    }
+
+    const int nTotal = nPerCycle*finalId;
+    const float frac = 0.15f;
+    const float ds = frac*nTotal;
+    const float ids = 1.0f/ds;
+    const int nBegin = frac*nTotal;
+    const int nEnd = (1.0f - frac)*nTotal;
+
+    for (int i = 0; i < finalId; i++) {
+        const float k = cycleMod*finalId + i;
+        if (k < nBegin) {
+            dst[i] *= scalar*(k*ids);
+        } else if (k > nEnd) {
+            dst[i] *= scalar*(((float)(nTotal) - k)*ids);
+        } else {
+            dst[i] *= scalar;
+        }
+    }
+}
+
+// resolution of the search for the start of the variable-length payload
+constexpr int kStepsPerFrame = 16;
+
+// states of GGWave::RxCandidate
+constexpr int8_t kCandidatePending  = 0;
+constexpr int8_t kCandidateComplete = 1;
+constexpr int8_t kCandidateRejected = 2;
+
+// power of two DFT bins of real-valued data, computed with the Goertzel algorithm
+//
+// The data is split in kGoertzelBlocks blocks with independent recurrences, so that the inner loop can be
+// vectorized. "src" must be transposed, i.e. src[i*kGoertzelBlocks + m] is sample i of block m.
+// The results of the blocks are phase-shifted and summed to obtain the DFT of the whole data.
+constexpr int kGoertzelBlocks = 8;
+
+// final states s1, s2 of the block recurrences for the two bins
+struct GoertzelState {
+    float s01[kGoertzelBlocks];
+    float s02[kGoertzelBlocks];
+    float s11[kGoertzelBlocks];
+    float s12[kGoertzelBlocks];
+};
+
+void goertzelRun(const float * src, int nPerBlock, float c0, float c1, GoertzelState & res) {
+    float s01[kGoertzelBlocks] = { 0.0f }, s02[kGoertzelBlocks] = { 0.0f };
+    float s11[kGoertzelBlocks] = { 0.0f }, s12[kGoertzelBlocks] = { 0.0f };
+
+    for (int i = 0; i < nPerBlock; ++i) {
+        const float * x = src + i*kGoertzelBlocks;
+        for (int m = 0; m < kGoertzelBlocks; ++m) {
+            const float s00 = x[m] + c0*s01[m] - s02[m];
+            const float s10 = x[m] + c1*s11[m] - s12[m];
+            s02[m] = s01[m]; s01[m] = s00;
+            s12[m] = s11[m]; s11[m] = s10;
+        }
+    }
+
+    for (int m = 0; m < kGoertzelBlocks; ++m) {
+        res.s01[m] = s01[m];
+        res.s02[m] = s02[m];
+        res.s11[m] = s11[m];
+        res.s12[m] = s12[m];
+    }
+}
+
+// X = sum_m exp(-i*w*m*nPerBlock)*(s1[m] - exp(-i*w)*s2[m]), up to a common phase factor
+float goertzelCombine(double w, int nPerBlock, const float * s1, const float * s2) {
+    const double dr = cos(w*nPerBlock), di = -sin(w*nPerBlock);
+    const double er = cos(w),           ei = -sin(w);
+
+    double rr = 1.0, ri = 0.0;
+    double xr = 0.0, xi = 0.0;
+    for (int m = 0; m < kGoertzelBlocks; ++m) {
+        const double yr = s1[m] - er*s2[m];
+        const double yi =       - ei*s2[m];
+
+        xr += rr*yr - ri*yi;
+        xi += rr*yi + ri*yr;
+
+        const double tr = rr*dr - ri*di;
+        ri = rr*di + ri*dr;
+        rr = tr;
+    }
+
+    return xr*xr + xi*xi;
+}
+
+void goertzelPower(const float * src, int N, int bin0, int bin1, float & p0, float & p1) {
+    const int nPerBlock = N/kGoertzelBlocks;
+
+    const double w0 = (2.0*M_PI*bin0)/N;
+    const double w1 = (2.0*M_PI*bin1)/N;
+
+    GoertzelState state;
+    goertzelRun(src, nPerBlock, 2.0f*cos(w0), 2.0f*cos(w1), state);
+
+    p0 = goertzelCombine(w0, nPerBlock, state.s01, state.s02);
+    p1 = goertzelCombine(w1, nPerBlock, state.s11, state.s12);
+}
+
+int64_t timestamp_us() {
+#ifdef ARDUINO
+    return micros();
+#else
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
 int getECCBytesForLength(int len) {
     return len < 4 ? 2 : GG_MAX(4, 2*(len/5));
 }
 
+void addRSStats(GGWave::RxStats & stats, const RS::ReedSolomon & rs) {
+    ++stats.nRSDecodes;
+    stats.nRSLocator   += rs.decode_stage >= RS::ReedSolomon::STAGE_LOCATOR   ? 1 : 0;
+    stats.nRSChien     += rs.decode_stage >= RS::ReedSolomon::STAGE_CHIEN     ? 1 : 0;
+    stats.nRSCorrected += rs.decode_stage >= RS::ReedSolomon::STAGE_CORRECTED ? 1 : 0;
+}
+
+// Reed-Solomon decoding with the least reliable bytes marked as erasures
+//
+//   If the decoding fails, it is retried with the 2, 4, ... least reliable bytes of the codeword as erasures. Each
+//   erasure needs one ECC byte instead of two for an error, but leaves fewer ECC bytes for detecting a wrong
+//   correction, so at most half of the ECC bytes are used for erasures and a retry is accepted only if at least 2 ECC
+//   bytes remain unused. The decoder accepts only corrections that are codewords and writes dst only if the decoding
+//   is accepted
+//
+//   confidence - for each byte of src, lower is less reliable
+//   erasures   - work buffer with space for ecc_length/2 positions
+//
+int decodeRS(RS::ReedSolomon & rs, const uint8_t * src, const uint8_t * confidence, uint8_t * erasures, uint8_t * dst, GGWave::RxStats & stats) {
+    int res = rs.Decode(src, dst);
+    addRSStats(stats, rs);
+
+    const int n = rs.msg_length + rs.ecc_length;
+    const int maxErasures = (rs.ecc_length/2) & ~1;
+
+    rs.ecc_reserved = 2;
+
+    // the bytes in order of increasing confidence, then position
+    int lastConfidence = -1;
+    int lastPos = n;
+    for (int k = 0; res != 0 && k < maxErasures; ) {
+        int pos = -1;
+        for (int i = 0; i < n; ++i) {
+            if (confidence[i] < lastConfidence || (confidence[i] == lastConfidence && i <= lastPos)) {
+                continue;
+            }
+            if (pos < 0 || confidence[i] < confidence[pos]) {
+                pos = i;
+            }
+        }
+
+        erasures[k++] = pos;
+        lastConfidence = confidence[pos];
+        lastPos = pos;
+
+        if (k % 2 == 0) {
+            res = rs.Decode(src, dst, erasures, k);
+            addRSStats(stats, rs);
+            ++stats.nRSErasures;
+        }
+    }
+
+    return res;
+}
+
+// smallest index reported by any of the decoding tasks
+//   The Arduino builds run the tasks serially, so a plain int is enough there
+struct SharedMinIndex {
+#ifdef ARDUINO
+    int value;
+
+    explicit SharedMinIndex(int init) : value(init) {}
+
+    int load() const { return value; }
+    void lower(int i) { if (i < value) value = i; }
+#else
+    std::atomic<int> value;
+
+    explicit SharedMinIndex(int init) : value(init) {}
+
+    int load() const { return value.load(std::memory_order_relaxed); }
+    void lower(int i) {
+        int cur = value.load(std::memory_order_relaxed);
+        while (i < cur && value.compare_exchange_weak(cur, i, std::memory_order_relaxed) == false) {}
+    }
+#endif
+};
+
 int bytesForSampleFormat(GGWave::SampleFormat sampleFormat) {
     switch (sampleFormat) {
         case GGWAVE_SAMPLE_FORMAT_UNDEFINED:    return 0;                   break;
@@ -468,6 +847,10 @@ GGWave::~GGWave() {
 }
 
 bool GGWave::prepare(const Parameters & parameters, bool allocate) {
+    return prepare(parameters, Executor(), allocate);
+}
+
+bool GGWave::prepare(const Parameters & parameters, const Executor & executor, bool allocate) {
     if (m_heap) {
         free(m_heap);
         m_heap = nullptr;
@@ -497,9 +880,19 @@ bool GGWave::prepare(const Parameters & parameters, bool allocate) {
     m_payloadLength        = parameters.payloadLength;
     m_isRxEnabled          = parameters.operatingMode & GGWAVE_OPERATING_MODE_RX;
     m_isTxEnabled          = parameters.operatingMode & GGWAVE_OPERATING_MODE_TX;
-    m_needResampling       = m_sampleRateInp != m_sampleRate || m_sampleRateOut != m_sampleRate;
+    m_needResamplingInp    = m_sampleRateInp != m_sampleRate;
+    m_needResamplingOut    = m_sampleRateOut != m_sampleRate;
     m_txOnlyTones          = parameters.operatingMode & GGWAVE_OPERATING_MODE_TX_ONLY_TONES;
     m_isDSSEnabled         = parameters.operatingMode & GGWAVE_OPERATING_MODE_USE_DSS;
+    m_isRxAmortized        = parameters.operatingMode & GGWAVE_OPERATING_MODE_RX_AMORTIZED;
+    m_isTxOscillator       = parameters.operatingMode & GGWAVE_OPERATING_MODE_TX_OSCILLATOR;
+    m_isTxStreaming        = parameters.operatingMode & GGWAVE_OPERATING_MODE_TX_STREAMING;
+    m_executor             = executor;
+    m_nWorkers             = executor.run ? GG_MAX(1, executor.nWorkers) : 1;
+
+    // the tone templates depend on the parameters
+    m_tx.nTemplateSets   = 0;
+    m_tx.templatesSource = nullptr;
 
     if (m_sampleSizeInp == 0) {
         ggprintf("Invalid or unsupported capture sample format: %d\n", (int) parameters.sampleFormatInp);
@@ -516,6 +909,11 @@ bool GGWave::prepare(const Parameters & parameters, bool allocate) {
         return false;
     }
 
+    if (fftIsValidSize(parameters.samplesPerFrame) == false) {
+        ggprintf("Invalid samples per frame: %d, must be a power of 2\n", parameters.samplesPerFrame);
+        return false;
+    }
+
     if (m_sampleRateInp < kSampleRateMin) {
         ggprintf("Error: capture sample rate (%g Hz) must be >= %g Hz\n", m_sampleRateInp, kSampleRateMin);
         return false;
@@ -558,8 +956,6 @@ bool GGWave::prepare(const Parameters & parameters, bool allocate) {
     if (m_isRxEnabled) {
         m_rx.samplesNeeded = m_samplesPerFrame;
 
-        m_rx.fftWorkI[0] = 0;
-
         m_rx.protocol   = {};
         m_rx.protocolId = GGWAVE_PROTOCOL_COUNT;
         m_rx.protocols  = Protocols::rx();
@@ -569,6 +965,19 @@ bool GGWave::prepare(const Parameters & parameters, bool allocate) {
 
     if (m_isTxEnabled) {
         m_tx.protocols = Protocols::tx();
+
+        if (m_txOnlyTones == false && m_isTxOscillator == false) {
+            m_tx.nTemplateSets = txTemplateSets(m_tx.protocols, m_tx.templatesFreqStart.data(), m_tx.templatesDataBits.data());
+
+            int row = 0;
+            for (int i = 0; i < m_tx.nTemplateSets; ++i) {
+                m_tx.templatesRow[i]       = row;
+                m_tx.templatesReady[i]     = 0;
+                m_tx.templatesSharedRow[i] = -1;
+
+                row += txTemplateRows(m_tx.templatesDataBits[i]);
+            }
+        }
     }
 
     return init("", {}, 0);
@@ -590,15 +999,18 @@ bool GGWave::alloc(void * p, int & n) {
 
     if (m_isRxEnabled) {
         ::ggalloc(m_rx.fftOut,   2*m_samplesPerFrame, p, n);
-        ::ggalloc(m_rx.fftWorkI, 3 + sqrt(m_samplesPerFrame/2), p, n);
-        ::ggalloc(m_rx.fftWorkF, m_samplesPerFrame/2, p, n);
+
+        // decode() resamples the capture data one frame at a time:
+        //  - the input of a frame is at most ceil(samplesPerFrame*factor) + 2 samples, see Resampler::predictInputSamples()
+        //  - when upsampling, the last input sample can produce up to ceil(1/factor) samples past the frame
+        const float factor = m_sampleRateInp/m_sampleRate;
+        const int maxSamplesInp = m_needResamplingInp ? (int) ceil(m_samplesPerFrame*factor) + 3 : m_samplesPerFrame;
+        const int maxSamplesOut = m_needResamplingInp ? m_samplesPerFrame + (int) ceil(1.0f/factor) + 1 : m_samplesPerFrame;
 
         ::ggalloc(m_rx.spectrum,           m_samplesPerFrame, p, n);
-        // small extra space because sometimes resampling needs a few more samples:
-        ::ggalloc(m_rx.amplitude,          m_needResampling ? m_samplesPerFrame + 128 : m_samplesPerFrame, p, n);
-        // min input sampling rate is 0.125*m_sampleRate:
-        ::ggalloc(m_rx.amplitudeResampled, m_needResampling ? 8*m_samplesPerFrame : m_samplesPerFrame, p, n);
-        ::ggalloc(m_rx.amplitudeTmp,       m_needResampling ? 8*m_samplesPerFrame*m_sampleSizeInp : m_samplesPerFrame*m_sampleSizeInp, p, n);
+        ::ggalloc(m_rx.amplitude,          maxSamplesOut, p, n);
+        ::ggalloc(m_rx.amplitudeResampled, maxSamplesInp, p, n);
+        ::ggalloc(m_rx.amplitudeTmp,       maxSamplesInp*m_sampleSizeInp, p, n);
 
         ::ggalloc(m_rx.data, maxLength + 1, p, n); // extra byte for null-termination
 
@@ -608,14 +1020,147 @@ bool GGWave::alloc(void * p, int & n) {
                 return false;
             }
 
-            ::ggalloc(m_rx.spectrumHistoryFixed, totalTxs*maxFramesPerTx(Protocols::rx(), false), m_samplesPerFrame, p, n);
-            ::ggalloc(m_rx.detectedBins,         2*totalLength, p, n);
-            ::ggalloc(m_rx.detectedTones,        2*16*maxBytesPerTx(Protocols::rx()), p, n);
+            // the lanes and the Tx slots of all protocols that can be received
+            const auto & protocols = Protocols::rx();
+
+            int nLanes = 0;
+            int nSlots = 0;
+            int maxTotalFrames = 0;
+            for (int i = 0; i < protocols.size(); ++i) {
+                const auto & protocol = protocols[i];
+                if (protocol.enabled == false || protocol.freqStart > m_samplesPerFrame) {
+                    continue;
+                }
+
+                const int nProtocolLanes = 2*protocol.bytesPerTx/protocol.extra;
+                const int nProtocolTxs   = protocol.extra*((totalLength + protocol.bytesPerTx - 1)/protocol.bytesPerTx);
+
+                nLanes += nProtocolLanes;
+                nSlots += nProtocolLanes*nProtocolTxs;
+                maxTotalFrames = GG_MAX(maxTotalFrames, nProtocolTxs*protocol.framesPerTx);
+            }
+
+            // only the bins of the lanes are quantized and stored
+            auto isBinUsed = [&](int bin) {
+                for (int i = 0; i < protocols.size(); ++i) {
+                    const auto & protocol = protocols[i];
+                    if (protocol.enabled == false || protocol.freqStart > m_samplesPerFrame) {
+                        continue;
+                    }
+
+                    const int nProtocolLanes = 2*protocol.bytesPerTx/protocol.extra;
+                    for (int t = 0; t < nProtocolLanes; ++t) {
+                        const int binStart = protocol.freqStart + t*16*protocol.extra;
+                        if (bin >= binStart && bin < binStart + 16) {
+                            return true;
+                        }
+                    }
+                }
+
+                return false;
+            };
+
+            int nBins = 0;
+            for (int bin = 0; bin < m_samplesPerFrame; ++bin) {
+                nBins += isBinUsed(bin) ? 1 : 0;
+            }
+
+            ::ggalloc(m_rx.amplitudeAverage,  m_samplesPerFrame, p, n); // the last frame, for rxTakeSpectrum()
+            ::ggalloc(m_rx.binsFixed,         nBins, p, n);
+            ::ggalloc(m_rx.spectrumFixed,     nBins, p, n);
+            ::ggalloc(m_rx.laneBinFixed,      nLanes, p, n);
+            ::ggalloc(m_rx.tonesHistoryFixed, maxTotalFrames + 1, nLanes, p, n); // +1 for the frame that leaves the window
+            ::ggalloc(m_rx.votesFixed,        nSlots, 16, p, n);
+            ::ggalloc(m_rx.majorityFixed,     nSlots, p, n);
+            ::ggalloc(m_rx.laneOffsetFixed,   protocols.size(), p, n);
+            ::ggalloc(m_rx.slotOffsetFixed,   protocols.size(), p, n);
+            ::ggalloc(m_rx.nDetectedFixed,    protocols.size(), p, n);
+            ::ggalloc(m_rx.isChangedFixed,    protocols.size(), p, n);
+            ::ggalloc(m_rx.confidenceFixed,   totalLength, p, n);
+            ::ggalloc(m_rx.erasuresFixed,     getECCBytesForLength(maxLength)/2, p, n);
+
+            if (p) {
+                nBins = 0;
+                for (int bin = 0; bin < m_samplesPerFrame; ++bin) {
+                    if (isBinUsed(bin)) {
+                        m_rx.binsFixed[nBins++] = bin;
+                    }
+                }
+
+                nLanes = 0;
+                nSlots = 0;
+                for (int i = 0; i < protocols.size(); ++i) {
+                    const auto & protocol = protocols[i];
+
+                    m_rx.laneOffsetFixed[i] = -1;
+                    m_rx.slotOffsetFixed[i] = -1;
+                    m_rx.nDetectedFixed[i]  = -1;
+                    m_rx.isChangedFixed[i]  = 1;
+
+                    if (protocol.enabled == false || protocol.freqStart > m_samplesPerFrame) {
+                        continue;
+                    }
+
+                    const int nProtocolLanes = 2*protocol.bytesPerTx/protocol.extra;
+                    const int nProtocolTxs   = protocol.extra*((totalLength + protocol.bytesPerTx - 1)/protocol.bytesPerTx);
+
+                    m_rx.laneOffsetFixed[i] = nLanes;
+                    m_rx.slotOffsetFixed[i] = nSlots;
+
+                    // the 16 bins of a lane are consecutive in spectrumFixed too
+                    for (int t = 0; t < nProtocolLanes; ++t) {
+                        const int binStart = protocol.freqStart + t*16*protocol.extra;
+                        for (int j = 0; j < nBins; ++j) {
+                            if (m_rx.binsFixed[j] == binStart) {
+                                m_rx.laneBinFixed[nLanes + t] = j;
+                                break;
+                            }
+                        }
+                    }
+
+                    nLanes += nProtocolLanes;
+                    nSlots += nProtocolLanes*nProtocolTxs;
+                }
+            }
         } else {
             // variable payload length
-            ::ggalloc(m_rx.amplitudeRecorded, kMaxRecordedFrames*m_samplesPerFrame, p, n);
+            // one candidate per start offset for each protocol that shares the detected start frequency
+            const int maxCandidates = maxProtocolsPerFreqStart(Protocols::rx())*m_nMarkerFrames*kStepsPerFrame;
+
+            // enough rows to hold all steps of the last 2 Txs and the frame that follows them
+            const int maxStepBins = 2*16*maxBytesPerTx(Protocols::rx());
+            const int maxSteps    = (2*maxFramesPerTx(Protocols::rx(), true) + 1)*kStepsPerFrame;
+
+            // the recorded frames are needed only until the spectra of their steps are computed
+            const int maxRecordedFrames = maxSteps/kStepsPerFrame + 1;
+
+            ::ggalloc(m_rx.amplitudeRecorded, maxRecordedFrames*m_samplesPerFrame, p, n);
             ::ggalloc(m_rx.amplitudeAverage,  m_samplesPerFrame, p, n);
             ::ggalloc(m_rx.amplitudeHistory,  kMaxSpectrumHistory, m_samplesPerFrame, p, n);
+            ::ggalloc(m_rx.amplitudeMarker,   m_samplesPerFrame, p, n);
+
+            for (auto & bank : m_rx.banks) {
+                ::ggalloc(bank.candidates,           maxCandidates, p, n);
+                ::ggalloc(bank.candidatesData,       maxCandidates, totalLength + m_encodedDataOffset, p, n);
+                ::ggalloc(bank.candidatesConfidence, maxCandidates, totalLength + m_encodedDataOffset, p, n);
+                ::ggalloc(bank.stepSpectrumId,       maxSteps, p, n);
+                ::ggalloc(bank.stepSpectrumCache,    maxSteps, 2*maxStepBins, p, n);
+            }
+
+            ::ggalloc(m_rx.stepSpectrumSum, m_nWorkers, 2*maxStepBins, p, n);
+            ::ggalloc(m_rx.workRSLength,    m_nWorkers, RS::ReedSolomon::getWorkSize_bytes(1, m_encodedDataOffset - 1), p, n);
+            ::ggalloc(m_rx.workRSData,      m_nWorkers, RS::ReedSolomon::getWorkSize_bytes(maxLength, getECCBytesForLength(maxLength)), p, n);
+            ::ggalloc(m_rx.workData,        m_nWorkers, maxLength + 1, p, n);
+            ::ggalloc(m_rx.workErasures,    m_nWorkers, getECCBytesForLength(maxLength)/2, p, n);
+            ::ggalloc(m_rx.workDecoded,     m_nWorkers, p, n);
+            ::ggalloc(m_rx.workStats,       m_nWorkers, p, n);
+
+            if (m_samplesPerFrame % kStepsPerFrame != 0) {
+                ggprintf("Invalid samples per frame: %d, must be a multiple of %d\n", m_samplesPerFrame, kStepsPerFrame);
+                return false;
+            }
+
+            m_rx.stepDFT.alloc(p, n, m_samplesPerFrame, kStepsPerFrame, maxStepBins);
         }
     }
 
@@ -623,19 +1168,41 @@ bool GGWave::alloc(void * p, int & n) {
         const int maxDataBits = 2*16*maxBytesPerTx(Protocols::tx());
 
         if (m_txOnlyTones == false) {
-            ::ggalloc(m_tx.phaseOffsets,    maxDataBits, p, n);
-            ::ggalloc(m_tx.bit0Amplitude,   maxDataBits, m_samplesPerFrame, p, n);
-            ::ggalloc(m_tx.bit1Amplitude,   maxDataBits, m_samplesPerFrame, p, n);
-            ::ggalloc(m_tx.output,          m_samplesPerFrame, p, n);
-            ::ggalloc(m_tx.outputResampled, 2*m_samplesPerFrame, p, n);
-            ::ggalloc(m_tx.outputTmp,       kMaxRecordedFrames*m_samplesPerFrame*m_sampleSizeOut, p, n);
-            ::ggalloc(m_tx.outputI16,       kMaxRecordedFrames*m_samplesPerFrame, p, n);
-        }
+            if (m_isTxOscillator == false) {
+                int freqStart[GGWAVE_PROTOCOL_COUNT];
+                int dataBits[GGWAVE_PROTOCOL_COUNT];
 
-        const int maxTones    = m_isFixedPayloadLength ? maxTonesPerTx(Protocols::tx()) : m_nBitsInMarker;
+                const int nSets = txTemplateSets(Protocols::tx(), freqStart, dataBits);
 
-        ::ggalloc(m_tx.data,     maxLength + 1, p, n); // first byte stores the length
-        ::ggalloc(m_tx.dataBits, maxDataBits, p, n);
+                int nRows = 0;
+                for (int i = 0; i < nSets; ++i) {
+                    nRows += txTemplateRows(dataBits[i]);
+                }
+
+                ::ggalloc(m_tx.phaseOffsets,       maxDataBits, p, n);
+                ::ggalloc(m_tx.bit0Amplitude,      nRows, m_samplesPerFrame, p, n);
+                ::ggalloc(m_tx.bit1Amplitude,      nRows, m_samplesPerFrame, p, n);
+                ::ggalloc(m_tx.templatesFreqStart, nSets, p, n);
+                ::ggalloc(m_tx.templatesDataBits,  nSets, p, n);
+                ::ggalloc(m_tx.templatesRow,       nSets, p, n);
+                ::ggalloc(m_tx.templatesReady,     nSets, p, n);
+                ::ggalloc(m_tx.templatesSharedRow, nSets, p, n);
+            }
+
+            ::ggalloc(m_tx.frameTones,      GG_MAX(m_nBitsInMarker, maxDataBits), p, n);
+            ::ggalloc(m_tx.output,          m_samplesPerFrame, p, n);
+            ::ggalloc(m_tx.outputResampled, 2*m_samplesPerFrame, p, n);
+
+            if (m_isTxStreaming == false) {
+                ::ggalloc(m_tx.outputTmp,   kMaxRecordedFrames*m_samplesPerFrame*m_sampleSizeOut, p, n);
+                ::ggalloc(m_tx.outputI16,   kMaxRecordedFrames*m_samplesPerFrame, p, n);
+            }
+        }
+
+        const int maxTones    = m_isFixedPayloadLength ? maxTonesPerTx(Protocols::tx()) : m_nBitsInMarker;
+
+        ::ggalloc(m_tx.data,     maxLength + 1, p, n); // first byte stores the length
+        ::ggalloc(m_tx.dataBits, maxDataBits, p, n);
         ::ggalloc(m_tx.tones,    maxTones*totalTxs + (maxTones > 1 ? totalTxs : 0), p, n);
     }
 
@@ -643,14 +1210,59 @@ bool GGWave::alloc(void * p, int & n) {
     {
         const auto maxLength = m_isFixedPayloadLength ? m_payloadLength : kMaxLengthVariable;
 
-        if (m_isFixedPayloadLength == false) {
+        // the variable-length Rx uses the work buffers of the workers
+        if (m_isFixedPayloadLength == false && m_isTxEnabled) {
             ::ggalloc(m_workRSLength, RS::ReedSolomon::getWorkSize_bytes(1, m_encodedDataOffset - 1), p, n);
         }
-        ::ggalloc(m_workRSData, RS::ReedSolomon::getWorkSize_bytes(maxLength, getECCBytesForLength(maxLength)), p, n);
+        if (m_isFixedPayloadLength || m_isTxEnabled) {
+            ::ggalloc(m_workRSData, RS::ReedSolomon::getWorkSize_bytes(maxLength, getECCBytesForLength(maxLength)), p, n);
+        }
+
+        // the generator polynomials for all ECC lengths that the Tx can use, computed once
+        if (m_isTxEnabled) {
+            const int minLength = m_isFixedPayloadLength ? m_payloadLength : 1;
+            const int maxECCLength = GG_MAX(getECCBytesForLength(maxLength), m_encodedDataOffset - 1);
+
+            auto isECCLengthUsed = [&](int eccLength) {
+                if (m_isFixedPayloadLength == false && eccLength == m_encodedDataOffset - 1) {
+                    return true;
+                }
+                for (int length = minLength; length <= maxLength; ++length) {
+                    if (getECCBytesForLength(length) == eccLength) {
+                        return true;
+                    }
+                }
+                return false;
+            };
+
+            int totalSize = 0;
+            for (int eccLength = 1; eccLength <= maxECCLength; ++eccLength) {
+                totalSize += isECCLengthUsed(eccLength) ? RS::ReedSolomon::getGeneratorSize_bytes(eccLength) : 0;
+            }
+
+            ::ggalloc(m_rsGenerators,      totalSize, p, n);
+            ::ggalloc(m_rsGeneratorOffset, maxECCLength + 1, p, n);
+
+            if (p) {
+                int offset = 0;
+                for (int eccLength = 0; eccLength <= maxECCLength; ++eccLength) {
+                    m_rsGeneratorOffset[eccLength] = -1;
+                    if (eccLength > 0 && isECCLengthUsed(eccLength)) {
+                        m_rsGeneratorOffset[eccLength] = offset;
+                        RS::ReedSolomon::GeneratorPoly(eccLength, m_rsGenerators.data() + offset);
+                        offset += RS::ReedSolomon::getGeneratorSize_bytes(eccLength);
+                    }
+                }
+            }
+        }
     }
 
-    if (m_needResampling) {
-        m_resampler.alloc(p, n);
+    if (m_isRxEnabled && m_needResamplingInp) {
+        m_resamplerInp.alloc(p, n, m_sampleRateInp, m_sampleRate);
+    }
+
+    if (m_isTxEnabled && m_txOnlyTones == false && m_needResamplingOut) {
+        m_resamplerOut.alloc(p, n, m_sampleRate, m_sampleRateOut);
     }
 
     return true;
@@ -701,6 +1313,7 @@ bool GGWave::init(int dataSize, const char * dataBuffer, TxProtocolId protocolId
         }
 
         m_tx.hasData = false;
+        m_tx.isRenderPrepared = false;
         m_tx.data.zero();
         m_dataEncoded.zero();
 
@@ -735,6 +1348,10 @@ bool GGWave::init(int dataSize, const char * dataBuffer, TxProtocolId protocolId
             }
 
             m_tx.hasData = true;
+
+            if (m_needResamplingOut && m_txOnlyTones == false) {
+                m_resamplerOut.reset();
+            }
         }
     } else {
         if (dataSize > 0) {
@@ -746,6 +1363,7 @@ bool GGWave::init(int dataSize, const char * dataBuffer, TxProtocolId protocolId
     if (m_isRxEnabled) {
         m_rx.receiving = false;
         m_rx.analyzing = false;
+        m_rx.isAnalysisQueued = false;
 
         m_rx.framesToAnalyze = 0;
         m_rx.framesLeftToAnalyze = 0;
@@ -756,9 +1374,14 @@ bool GGWave::init(int dataSize, const char * dataBuffer, TxProtocolId protocolId
         m_rx.amplitude.zero();
         m_rx.amplitudeHistory.zero();
 
+        m_rx.isSpectrumStale = false;
+
         m_rx.data.zero();
 
-        m_rx.spectrumHistoryFixed.zero();
+        // the votes of the fixed-length decoding are reset on the next frame
+        for (int i = 0; i < m_rx.nDetectedFixed.size(); ++i) {
+            m_rx.nDetectedFixed[i] = -1;
+        }
     }
 
     return true;
@@ -773,31 +1396,24 @@ uint32_t GGWave::encodeSize_samples() const {
         return 0;
     }
 
-    float factor = 1.0f;
-    int samplesPerFrameOut = m_samplesPerFrame;
-    if (m_needResampling) {
-        factor = m_sampleRate/m_sampleRateOut;
-        // note : +1 extra sample in order to overestimate the buffer size
-        samplesPerFrameOut = m_resampler.resample(factor, m_samplesPerFrame, m_tx.output.data(), nullptr) + 1;
-    }
     const int nECCBytesPerTx = getECCBytesForLength(m_tx.dataLength);
     const int sendDataLength = m_tx.dataLength + m_encodedDataOffset;
     const int totalBytes = sendDataLength + nECCBytesPerTx;
     const int totalDataFrames = m_tx.protocol.extra*((totalBytes + m_tx.protocol.bytesPerTx - 1)/m_tx.protocol.bytesPerTx)*m_tx.protocol.framesPerTx;
 
-    return (
-            m_nMarkerFrames + totalDataFrames + m_nMarkerFrames
-           )*samplesPerFrameOut;
-}
+    const int nSamples = (m_nMarkerFrames + totalDataFrames + m_nMarkerFrames)*m_samplesPerFrame;
 
-uint32_t GGWave::encode() {
-    if (m_isTxEnabled == false) {
-        ggprintf("Tx is disabled - cannot transmit data with this GGWave instance\n");
-        return 0;
+    if (m_needResamplingOut) {
+        // the resampler is reset when the transmission is initialized
+        return m_resamplerOut.predictOutputSamples(nSamples);
     }
 
-    if (m_needResampling) {
-        m_resampler.reset();
+    return nSamples;
+}
+
+void GGWave::prepareTx() {
+    if (m_needResamplingOut) {
+        m_resamplerOut.reset();
     }
 
     const int nECCBytesPerTx = getECCBytesForLength(m_tx.dataLength);
@@ -806,67 +1422,29 @@ uint32_t GGWave::encode() {
     const int totalDataFrames = m_tx.protocol.extra*((totalBytes + m_tx.protocol.bytesPerTx - 1)/m_tx.protocol.bytesPerTx)*m_tx.protocol.framesPerTx;
 
     if (m_isFixedPayloadLength == false) {
-        RS::ReedSolomon rsLength(1, m_encodedDataOffset - 1, m_workRSLength.data());
+        RS::ReedSolomon rsLength(1, m_encodedDataOffset - 1, m_workRSLength.data(), rsGenerator(m_encodedDataOffset - 1));
         rsLength.Encode(m_tx.data.data(), m_dataEncoded.data());
     }
 
     // first byte of m_tx.data contains the length of the payload, so we skip it:
-    RS::ReedSolomon rsData = RS::ReedSolomon(m_tx.dataLength, nECCBytesPerTx, m_workRSData.data());
+    RS::ReedSolomon rsData = RS::ReedSolomon(m_tx.dataLength, nECCBytesPerTx, m_workRSData.data(), rsGenerator(nECCBytesPerTx));
     rsData.Encode(m_tx.data.data() + 1, m_dataEncoded.data() + m_encodedDataOffset);
 
+    m_tx.totalDataFrames = totalDataFrames;
+
     // generate tones
     {
         int frameId = 0;
-        bool hasData = m_tx.hasData;
 
         m_tx.nTones = 0;
-        while (hasData) {
-            if (frameId < m_nMarkerFrames) {
-                for (int i = 0; i < m_nBitsInMarker; ++i) {
-                    m_tx.tones[m_tx.nTones++] = 2*i + i%2;
-                }
-            } else if (frameId < m_nMarkerFrames + totalDataFrames) {
-                int dataOffset = frameId - m_nMarkerFrames;
-                dataOffset /= m_tx.protocol.framesPerTx;
-                dataOffset *= m_tx.protocol.bytesPerTx;
-
-                m_tx.dataBits.zero();
-
-                for (int j = 0; j < m_tx.protocol.bytesPerTx; ++j) {
-                    if (m_tx.protocol.extra == 1) {
-                        {
-                            uint8_t d = m_dataEncoded[dataOffset + j] & 15;
-                            m_tx.dataBits[(2*j + 0)*16 + d] = 1;
-                        }
-                        {
-                            uint8_t d = m_dataEncoded[dataOffset + j] & 240;
-                            m_tx.dataBits[(2*j + 1)*16 + (d >> 4)] = 1;
-                        }
-                    } else {
-                        if (dataOffset % m_tx.protocol.extra == 0) {
-                            uint8_t d = m_dataEncoded[dataOffset/m_tx.protocol.extra + j] & 15;
-                            m_tx.dataBits[(2*j + 0)*16 + d] = 1;
-                        } else {
-                            uint8_t d = m_dataEncoded[dataOffset/m_tx.protocol.extra + j] & 240;
-                            m_tx.dataBits[(2*j + 0)*16 + (d >> 4)] = 1;
-                        }
-                    }
-                }
-
-                for (int k = 0; k < 2*m_tx.protocol.bytesPerTx*16; ++k) {
-                    if (m_tx.dataBits[k] == 0) continue;
-
-                    m_tx.tones[m_tx.nTones++] = k;
-                }
-            } else if (frameId < m_nMarkerFrames + totalDataFrames + m_nMarkerFrames) {
-                for (int i = 0; i < m_nBitsInMarker; ++i) {
-                    m_tx.tones[m_tx.nTones++] = 2*i + (1 - i%2);
-                }
-            } else {
-                hasData = false;
+        while (m_tx.hasData) {
+            const int nFrameTones = frameTones(frameId, m_tx.tones.data() + m_tx.nTones);
+            if (nFrameTones < 0) {
                 break;
             }
 
+            m_tx.nTones += nFrameTones;
+
             if (m_tx.protocol.nTones() > 1) {
                 m_tx.tones[m_tx.nTones++] = -1;
             }
@@ -875,15 +1453,39 @@ uint32_t GGWave::encode() {
         }
 
         if (m_txOnlyTones) {
-            m_tx.hasData = false;
-            return true;
+            return;
         }
     }
 
-    // compute Tx data
-    {
-        for (int k = 0; k < (int) m_tx.phaseOffsets.size(); ++k) {
-            m_tx.phaseOffsets[k] = (M_PI*k)/(m_tx.protocol.nDataBitsPerTx());
+    m_tx.frameId = 0;
+    m_tx.frameSamples = 0;
+    m_tx.frameSamplesTaken = 0;
+
+    if (m_isTxOscillator || m_tx.hasData == false) {
+        // the tones are generated on the fly or there is nothing to render
+        return;
+    }
+
+    const int dataBits = m_tx.protocol.nDataBitsPerTx();
+    const int setId    = txTemplateSet(m_tx.protocol.freqStart, dataBits);
+    const int nRows    = txTemplateRows(dataBits);
+
+    if (m_tx.templatesSource && m_tx.templatesSharedRow[setId] >= 0) {
+        // the source never overwrites these templates, so they stay valid for the whole transmission
+        const int row = m_tx.templatesSharedRow[setId];
+
+        m_tx.bit0Templates = AmplitudeArr(m_tx.templatesSource->m_tx.bit0Amplitude[row].data(), nRows, m_samplesPerFrame);
+        m_tx.bit1Templates = AmplitudeArr(m_tx.templatesSource->m_tx.bit1Amplitude[row].data(), nRows, m_samplesPerFrame);
+
+        return;
+    }
+
+    const int row = m_tx.templatesRow[setId];
+
+    if (m_tx.templatesReady[setId] == 0) {
+        // compute the tone templates of the protocol
+        for (int k = 0; k < nRows; ++k) {
+            m_tx.phaseOffsets[k] = (M_PI*k)/dataBits;
         }
 
         // note : what is the purpose of this shuffle ? I forgot .. :(
@@ -892,109 +1494,174 @@ uint32_t GGWave::encode() {
 
         //std::shuffle(phaseOffsets.begin(), phaseOffsets.end(), g);
 
-        for (int k = 0; k < (int) m_tx.dataBits.size(); ++k) {
+        for (int k = 0; k < nRows; ++k) {
             const double freq = bitFreq(m_tx.protocol, k);
 
             const double phaseOffset = m_tx.phaseOffsets[k];
             const double curHzPerSample = m_hzPerSample;
             const double curIHzPerSample = 1.0/curHzPerSample;
 
+            auto bit1Amplitude = m_tx.bit1Amplitude[row + k];
+            auto bit0Amplitude = m_tx.bit0Amplitude[row + k];
+
             for (int i = 0; i < m_samplesPerFrame; i++) {
                 const double curi = i;
-                m_tx.bit1Amplitude[k][i] = sin((2.0*M_PI)*(curi*m_isamplesPerFrame)*(freq*curIHzPerSample) + phaseOffset);
+                bit1Amplitude[i] = sin((2.0*M_PI)*(curi*m_isamplesPerFrame)*(freq*curIHzPerSample) + phaseOffset);
             }
 
             for (int i = 0; i < m_samplesPerFrame; i++) {
                 const double curi = i;
-                m_tx.bit0Amplitude[k][i] = sin((2.0*M_PI)*(curi*m_isamplesPerFrame)*((freq + m_hzPerSample*m_freqDelta_bin)*curIHzPerSample) + phaseOffset);
+                bit0Amplitude[i] = sin((2.0*M_PI)*(curi*m_isamplesPerFrame)*((freq + m_hzPerSample*m_freqDelta_bin)*curIHzPerSample) + phaseOffset);
             }
         }
+
+        m_tx.templatesReady[setId] = 1;
     }
 
-    int frameId = 0;
-    uint32_t offset = 0;
-    const float factor = m_sampleRate/m_sampleRateOut;
+    m_tx.bit0Templates = AmplitudeArr(m_tx.bit0Amplitude[row].data(), nRows, m_samplesPerFrame);
+    m_tx.bit1Templates = AmplitudeArr(m_tx.bit1Amplitude[row].data(), nRows, m_samplesPerFrame);
+}
 
-    while (m_tx.hasData) {
-        m_tx.output.zero();
+int GGWave::frameTones(int frameId, Tone * tones) {
+    const int totalDataFrames = m_tx.totalDataFrames;
 
-        uint16_t nFreq = 0;
-        if (frameId < m_nMarkerFrames) {
-            nFreq = m_nBitsInMarker;
+    int nTones = 0;
 
-            for (int i = 0; i < m_nBitsInMarker; ++i) {
-                if (i%2 == 0) {
-                    ::addAmplitudeSmooth(m_tx.bit1Amplitude[i], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, frameId, m_nMarkerFrames);
-                } else {
-                    ::addAmplitudeSmooth(m_tx.bit0Amplitude[i], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, frameId, m_nMarkerFrames);
-                }
-            }
-        } else if (frameId < m_nMarkerFrames + totalDataFrames) {
-            int dataOffset = frameId - m_nMarkerFrames;
-            int cycleModMain = dataOffset%m_tx.protocol.framesPerTx;
-            dataOffset /= m_tx.protocol.framesPerTx;
-            dataOffset *= m_tx.protocol.bytesPerTx;
+    if (frameId < m_nMarkerFrames) {
+        for (int i = 0; i < m_nBitsInMarker; ++i) {
+            tones[nTones++] = 2*i + i%2;
+        }
+    } else if (frameId < m_nMarkerFrames + totalDataFrames) {
+        int dataOffset = frameId - m_nMarkerFrames;
+        dataOffset /= m_tx.protocol.framesPerTx;
+        dataOffset *= m_tx.protocol.bytesPerTx;
 
-            m_tx.dataBits.zero();
+        m_tx.dataBits.zero();
 
-            for (int j = 0; j < m_tx.protocol.bytesPerTx; ++j) {
-                if (m_tx.protocol.extra == 1) {
-                    {
-                        uint8_t d = m_dataEncoded[dataOffset + j] & 15;
-                        m_tx.dataBits[(2*j + 0)*16 + d] = 1;
-                    }
-                    {
-                        uint8_t d = m_dataEncoded[dataOffset + j] & 240;
-                        m_tx.dataBits[(2*j + 1)*16 + (d >> 4)] = 1;
-                    }
-                } else {
-                    if (dataOffset % m_tx.protocol.extra == 0) {
-                        uint8_t d = m_dataEncoded[dataOffset/m_tx.protocol.extra + j] & 15;
-                        m_tx.dataBits[(2*j + 0)*16 + d] = 1;
-                    } else {
-                        uint8_t d = m_dataEncoded[dataOffset/m_tx.protocol.extra + j] & 240;
-                        m_tx.dataBits[(2*j + 0)*16 + (d >> 4)] = 1;
-                    }
+        for (int j = 0; j < m_tx.protocol.bytesPerTx; ++j) {
+            if (m_tx.protocol.extra == 1) {
+                {
+                    uint8_t d = m_dataEncoded[dataOffset + j] & 15;
+                    m_tx.dataBits[(2*j + 0)*16 + d] = 1;
                 }
-            }
-
-            for (int k = 0; k < 2*m_tx.protocol.bytesPerTx*16; ++k) {
-                if (m_tx.dataBits[k] == 0) continue;
-
-                ++nFreq;
-                if (k%2) {
-                    ::addAmplitudeSmooth(m_tx.bit0Amplitude[k/2], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, cycleModMain, m_tx.protocol.framesPerTx);
-                } else {
-                    ::addAmplitudeSmooth(m_tx.bit1Amplitude[k/2], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, cycleModMain, m_tx.protocol.framesPerTx);
+                {
+                    uint8_t d = m_dataEncoded[dataOffset + j] & 240;
+                    m_tx.dataBits[(2*j + 1)*16 + (d >> 4)] = 1;
                 }
-            }
-        } else if (frameId < m_nMarkerFrames + totalDataFrames + m_nMarkerFrames) {
-            nFreq = m_nBitsInMarker;
-
-            const int fId = frameId - (m_nMarkerFrames + totalDataFrames);
-            for (int i = 0; i < m_nBitsInMarker; ++i) {
-                if (i%2 == 0) {
-                    addAmplitudeSmooth(m_tx.bit0Amplitude[i], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, fId, m_nMarkerFrames);
+            } else {
+                if (dataOffset % m_tx.protocol.extra == 0) {
+                    uint8_t d = m_dataEncoded[dataOffset/m_tx.protocol.extra + j] & 15;
+                    m_tx.dataBits[(2*j + 0)*16 + d] = 1;
                 } else {
-                    addAmplitudeSmooth(m_tx.bit1Amplitude[i], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, fId, m_nMarkerFrames);
+                    uint8_t d = m_dataEncoded[dataOffset/m_tx.protocol.extra + j] & 240;
+                    m_tx.dataBits[(2*j + 0)*16 + (d >> 4)] = 1;
                 }
             }
-        } else {
-            m_tx.hasData = false;
-            break;
         }
 
-        if (nFreq == 0) nFreq = 1;
-        const float scale = 1.0f/nFreq;
-        for (int i = 0; i < m_samplesPerFrame; ++i) {
-            m_tx.output[i] *= scale;
+        for (int k = 0; k < 2*m_tx.protocol.bytesPerTx*16; ++k) {
+            if (m_tx.dataBits[k] == 0) continue;
+
+            tones[nTones++] = k;
         }
+    } else if (frameId < m_nMarkerFrames + totalDataFrames + m_nMarkerFrames) {
+        for (int i = 0; i < m_nBitsInMarker; ++i) {
+            tones[nTones++] = 2*i + (1 - i%2);
+        }
+    } else {
+        return -1;
+    }
 
-        int samplesPerFrameOut = m_samplesPerFrame;
-        if (m_needResampling) {
-            samplesPerFrameOut = m_resampler.resample(factor, m_samplesPerFrame, m_tx.output.data(), m_tx.outputResampled.data());
-        } else {
-            m_tx.outputResampled.copy(m_tx.output);
+    return nTones;
+}
+
+int GGWave::renderFrame() {
+    if (m_tx.hasData == false) {
+        return 0;
+    }
+
+    const int frameId = m_tx.frameId;
+    const int totalDataFrames = m_tx.totalDataFrames;
+
+    const int nFrameTones = frameTones(frameId, m_tx.frameTones.data());
+    if (nFrameTones < 0) {
+        m_tx.hasData = false;
+        return 0;
+    }
+
+    m_tx.output.zero();
+
+    // the part of the envelope of the tones that the frame covers
+    int cycleMod  = 0;
+    int nPerCycle = 0;
+
+    if (frameId < m_nMarkerFrames) {
+        cycleMod  = frameId;
+        nPerCycle = m_nMarkerFrames;
+    } else if (frameId < m_nMarkerFrames + totalDataFrames) {
+        cycleMod  = (frameId - m_nMarkerFrames)%m_tx.protocol.framesPerTx;
+        nPerCycle = m_tx.protocol.framesPerTx;
+    } else {
+        cycleMod  = frameId - (m_nMarkerFrames + totalDataFrames);
+        nPerCycle = m_nMarkerFrames;
+    }
+
+    if (m_isTxOscillator) {
+        ::generateTonesSmooth(m_tx.frameTones.data(), nFrameTones, m_tx.protocol.freqStart, m_tx.protocol.nDataBitsPerTx(),
+                              m_tx.output, m_tx.sendVolume, m_samplesPerFrame, cycleMod, nPerCycle);
+    } else {
+        for (int i = 0; i < nFrameTones; ++i) {
+            const int tone = m_tx.frameTones[i];
+            ::addAmplitudeSmooth(tone%2 ? m_tx.bit0Templates[tone/2] : m_tx.bit1Templates[tone/2],
+                                 m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, cycleMod, nPerCycle);
+        }
+    }
+
+    uint16_t nFreq = nFrameTones;
+    if (nFreq == 0) nFreq = 1;
+    const float scale = 1.0f/nFreq;
+    for (int i = 0; i < m_samplesPerFrame; ++i) {
+        m_tx.output[i] *= scale;
+    }
+
+    int samplesPerFrameOut = m_samplesPerFrame;
+    if (m_needResamplingOut) {
+        samplesPerFrameOut = m_resamplerOut.resample(m_samplesPerFrame, m_tx.output.data(), m_tx.outputResampled.data());
+    } else {
+        m_tx.outputResampled.copy(m_tx.output);
+    }
+
+    ++m_tx.frameId;
+
+    return samplesPerFrameOut;
+}
+
+uint32_t GGWave::encode() {
+    if (m_isTxEnabled == false) {
+        ggprintf("Tx is disabled - cannot transmit data with this GGWave instance\n");
+        return 0;
+    }
+
+    if (m_isTxStreaming && m_txOnlyTones == false) {
+        ggprintf("The waveform of a streaming Tx instance can be generated only with txRender()\n");
+        return 0;
+    }
+
+    m_tx.isRenderPrepared = false;
+
+    prepareTx();
+
+    if (m_txOnlyTones) {
+        m_tx.hasData = false;
+        return true;
+    }
+
+    uint32_t offset = 0;
+
+    while (true) {
+        const int samplesPerFrameOut = renderFrame();
+        if (samplesPerFrameOut == 0) {
+            break;
         }
 
         // default output is in 16-bit signed int so we always compute it
@@ -1003,47 +1670,10 @@ uint32_t GGWave::encode() {
         }
 
         // convert from 32-bit float
-        switch (m_sampleFormatOut) {
-            case GGWAVE_SAMPLE_FORMAT_UNDEFINED: break;
-            case GGWAVE_SAMPLE_FORMAT_U8:
-                {
-                    auto p = reinterpret_cast<uint8_t *>(m_tx.outputTmp.data());
-                    for (int i = 0; i < samplesPerFrameOut; ++i) {
-                        p[offset + i] = 128*(m_tx.outputResampled[i] + 1.0f);
-                    }
-                } break;
-            case GGWAVE_SAMPLE_FORMAT_I8:
-                {
-                    auto p = reinterpret_cast<uint8_t *>(m_tx.outputTmp.data());
-                    for (int i = 0; i < samplesPerFrameOut; ++i) {
-                        p[offset + i] = 128*m_tx.outputResampled[i];
-                    }
-                } break;
-            case GGWAVE_SAMPLE_FORMAT_U16:
-                {
-                    auto p = reinterpret_cast<uint16_t *>(m_tx.outputTmp.data());
-                    for (int i = 0; i < samplesPerFrameOut; ++i) {
-                        p[offset + i] = 32768*(m_tx.outputResampled[i] + 1.0f);
-                    }
-                } break;
-            case GGWAVE_SAMPLE_FORMAT_I16:
-                {
-                    // skip because we already have the data in m_tx.outputI16
-                    //auto p = reinterpret_cast<uint16_t *>(m_tx.outputTmp.data());
-                    //for (int i = 0; i < samplesPerFrameOut; ++i) {
-                    //    p[offset + i] = 32768*m_tx.outputResampled[i];
-                    //}
-                } break;
-            case GGWAVE_SAMPLE_FORMAT_F32:
-                {
-                    auto p = reinterpret_cast<float *>(m_tx.outputTmp.data());
-                    for (int i = 0; i < samplesPerFrameOut; ++i) {
-                        p[offset + i] = m_tx.outputResampled[i];
-                    }
-                } break;
+        if (m_sampleFormatOut != GGWAVE_SAMPLE_FORMAT_I16) {
+            ::convertOutput(m_tx.outputResampled.data(), samplesPerFrameOut, m_sampleFormatOut, (char *) m_tx.outputTmp.data() + offset*m_sampleSizeOut);
         }
 
-        ++frameId;
         offset += samplesPerFrameOut;
     }
 
@@ -1054,6 +1684,59 @@ uint32_t GGWave::encode() {
     return offset*m_sampleSizeOut;
 }
 
+bool GGWave::txBegin() {
+    if (m_isTxEnabled == false) {
+        ggprintf("Tx is disabled - cannot transmit data with this GGWave instance\n");
+        return false;
+    }
+
+    if (m_txOnlyTones) {
+        ggprintf("Cannot render the waveform with GGWAVE_OPERATING_MODE_TX_ONLY_TONES\n");
+        return false;
+    }
+
+    prepareTx();
+
+    m_tx.isRenderPrepared = true;
+
+    return true;
+}
+
+int GGWave::txRender(void * dst, int nSamples) {
+    if (m_tx.isRenderPrepared == false) {
+        ggprintf("Call txBegin() before rendering the waveform with txRender()\n");
+        return 0;
+    }
+
+    int nWritten = 0;
+
+    while (nWritten < nSamples) {
+        if (m_tx.frameSamplesTaken == m_tx.frameSamples) {
+            m_tx.frameSamples = renderFrame();
+            m_tx.frameSamplesTaken = 0;
+
+            if (m_tx.frameSamples == 0) {
+                break;
+            }
+        }
+
+        const int n = GG_MIN(nSamples - nWritten, m_tx.frameSamples - m_tx.frameSamplesTaken);
+
+        ::convertOutput(m_tx.outputResampled.data() + m_tx.frameSamplesTaken, n, m_sampleFormatOut, (char *) dst + nWritten*m_sampleSizeOut);
+
+        m_tx.frameSamplesTaken += n;
+        nWritten += n;
+    }
+
+    // all frames have been rendered and taken
+    if (m_tx.frameSamplesTaken == m_tx.frameSamples &&
+        m_tx.frameId == m_nMarkerFrames + m_tx.totalDataFrames + m_nMarkerFrames) {
+        m_tx.hasData = false;
+    }
+
+    return nWritten;
+}
+
 bool GGWave::decode(const void * data, uint32_t nBytes) {
     if (m_isRxEnabled == false) {
         ggprintf("Rx is disabled - cannot receive data with this GGWave instance\n");
@@ -1066,15 +1749,13 @@ bool GGWave::decode(const void * data, uint32_t nBytes) {
     }
 
     auto dataBuffer = (uint8_t *) data;
-    const float factor = m_sampleRateInp/m_sampleRate;
 
     while (true) {
         // read capture data
         uint32_t nBytesNeeded = m_rx.samplesNeeded*m_sampleSizeInp;
 
-        if (m_needResampling) {
-            // note : predict 4 extra samples just to make sure we have enough data
-            nBytesNeeded = (m_resampler.resample(1.0f/factor, m_rx.samplesNeeded, m_rx.amplitudeResampled.data(), nullptr) + 4)*m_sampleSizeInp;
+        if (m_needResamplingInp) {
+            nBytesNeeded = GG_MAX(1, m_resamplerInp.predictInputSamples(m_rx.samplesNeeded))*m_sampleSizeInp;
         }
 
         const uint32_t nBytesRecorded = GG_MIN(nBytes, nBytesNeeded);
@@ -1149,18 +1830,8 @@ bool GGWave::decode(const void * data, uint32_t nBytes) {
 
         uint32_t offset = m_samplesPerFrame - m_rx.samplesNeeded;
 
-        if (m_needResampling) {
-            if (nSamplesRecorded <= 2*Resampler::kWidth) {
-                m_rx.samplesNeeded = m_samplesPerFrame;
-                break;
-            }
-
-            // reset resampler state every minute
-            if (!m_rx.receiving && m_resampler.nSamplesTotal() > 60.0f*factor*m_sampleRate) {
-                m_resampler.reset();
-            }
-
-            int nSamplesResampled = offset + m_resampler.resample(factor, nSamplesRecorded, m_rx.amplitudeResampled.data(), m_rx.amplitude.data() + offset);
+        if (m_needResamplingInp) {
+            int nSamplesResampled = offset + m_resamplerInp.resample(nSamplesRecorded, m_rx.amplitudeResampled.data(), m_rx.amplitude.data() + offset);
             nSamplesRecorded = nSamplesResampled;
         } else {
             for (int i = 0; i < nSamplesRecorded; ++i) {
@@ -1249,6 +1920,42 @@ bool GGWave::txTakeAmplitudeI16(AmplitudeI16 & dst) {
 
 const GGWave::RxProtocols & GGWave::txProtocols() const { return m_tx.protocols; }
 
+bool GGWave::txShareTemplates(const GGWave * source) {
+    m_tx.templatesSource = nullptr;
+
+    if (source == nullptr || source == this) {
+        return source == nullptr;
+    }
+
+    if (m_isTxEnabled == false || m_txOnlyTones || m_isTxOscillator ||
+        source->m_isTxEnabled == false || source->m_txOnlyTones || source->m_isTxOscillator) {
+        ggprintf("Tone templates can be shared only between instances that generate waveforms\n");
+        return false;
+    }
+
+    if (source->m_samplesPerFrame != m_samplesPerFrame ||
+        source->m_sampleRate      != m_sampleRate ||
+        source->m_freqDelta_bin   != m_freqDelta_bin ||
+        source->m_freqDelta_hz    != m_freqDelta_hz) {
+        ggprintf("Tone templates can be shared only between instances with the same sample rate and samples per frame\n");
+        return false;
+    }
+
+    // share only the templates that the source has already computed - it never overwrites them
+    for (int i = 0; i < m_tx.nTemplateSets; ++i) {
+        const int setId = source->txTemplateSet(m_tx.templatesFreqStart[i], m_tx.templatesDataBits[i]);
+
+        m_tx.templatesSharedRow[i] = -1;
+        if (setId >= 0 && source->m_tx.templatesReady[setId]) {
+            m_tx.templatesSharedRow[i] = source->m_tx.templatesRow[setId];
+        }
+    }
+
+    m_tx.templatesSource = source;
+
+    return true;
+}
+
 //
 // Rx
 //
@@ -1264,15 +1971,34 @@ int GGWave::rxFramesLeftToAnalyze() const { return m_rx.framesLeftToAnalyze; }
 int GGWave::rxDurationFrames()      const { return m_rx.recvDuration_frames; }
 
 bool GGWave::rxStopReceiving() {
-    if (m_rx.receiving == false) {
+    if (m_rx.receiving == false && m_rx.analyzing == false) {
         return false;
     }
 
     m_rx.receiving = false;
+    m_rx.isAnalysisQueued = false;
+
+    // the analysis in progress is dropped as well
+    if (m_rx.analyzing) {
+        m_rx.analyzing = false;
+        m_rx.framesToRecord = 0;
+        m_rx.framesToAnalyze = 0;
+        m_rx.framesLeftToAnalyze = 0;
+    }
 
     return true;
 }
 
+bool GGWave::rxStep(int budget_us) {
+    if (m_rx.analyzing == false) {
+        return false;
+    }
+
+    analyze(budget_us);
+
+    return m_rx.analyzing;
+}
+
 GGWave::RxProtocols & GGWave::rxProtocols() { return m_rx.protocols; }
 
 int GGWave::rxDataLength() const { return m_rx.dataLength; }
@@ -1299,6 +2025,10 @@ int GGWave::rxTakeData(TxRxData & dst) {
 bool GGWave::rxTakeSpectrum(Spectrum & dst) {
     if (m_rx.hasNewSpectrum == false) return false;
 
+    if (m_rx.isSpectrumStale) {
+        updateSpectrum();
+    }
+
     m_rx.hasNewSpectrum = false;
     dst.assign(m_rx.spectrum);
 
@@ -1314,26 +2044,49 @@ bool GGWave::rxTakeAmplitude(Amplitude & dst) {
     return true;
 }
 
+const GGWave::RxStats & GGWave::rxStats() const { return m_rx.stats; }
+
 bool GGWave::computeFFTR(const float * src, float * dst, int N) {
     if (N != m_samplesPerFrame) {
         ggprintf("computeFFTR: N (%d) must be equal to 'samplesPerFrame' %d\n", N, m_samplesPerFrame);
         return false;
     }
 
-    FFT(src, dst, N, m_rx.fftWorkI.data(), m_rx.fftWorkF.data());
+    FFT(src, dst, N);
 
     return true;
 }
 
 int GGWave::computeFFTR(const float * src, float * dst, int N, int * wi, float * wf) {
-    if (wi == nullptr) return 2*N;
-    if (wf == nullptr) return 3 + sqrt(N/2);
+    if (wi == nullptr) return 1;
+    if (wf == nullptr) return 1;
+
+    if (fftIsValidSize(N) == false) {
+        ggprintf("computeFFTR: N (%d) must be a power of 2 in [2, %d]\n", N, kMaxSamplesPerFrame);
+        return 0;
+    }
 
-    FFT(src, dst, N, wi, wf);
+    FFT(src, dst, N);
 
     return 1;
 }
 
+bool GGWave::computeFFTRBatch(const float * src, float * dst, int N, int count, int stride) {
+    if (fftIsValidSize(N) == false) {
+        ggprintf("computeFFTRBatch: N (%d) must be a power of 2 in [2, %d]\n", N, kMaxSamplesPerFrame);
+        return false;
+    }
+
+    if (count < 0 || stride < 0) {
+        ggprintf("computeFFTRBatch: invalid count (%d) or stride (%d)\n", count, stride);
+        return false;
+    }
+
+    FFTBatch(src, dst, N, count, stride);
+
+    return true;
+}
+
 int GGWave::filter(ggwave_Filter filter, float * waveform, int N, float p0, float p1, float * w) {
     if (w == nullptr) {
         switch (filter) {
@@ -1407,16 +2160,141 @@ int GGWave::filter(ggwave_Filter filter, float * waveform, int N, float p0, floa
 // GGWave::Resampler
 //
 
-GGWave::Resampler::Resampler() {}
+// Dot product of x with a, n must be a multiple of 8
+inline float dotProduct(const float * x, const float * a, int n) {
+#if defined(GGWAVE_SSE)
+    __m128 s0 = _mm_setzero_ps();
+    __m128 s1 = _mm_setzero_ps();
+    for (int i = 0; i < n; i += 8) {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(x + i),     _mm_loadu_ps(a + i)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(a + i + 4)));
+    }
+    float t[4];
+    _mm_storeu_ps(t, _mm_add_ps(s0, s1));
+    return (t[0] + t[1]) + (t[2] + t[3]);
+#elif defined(GGWAVE_NEON)
+    float32x4_t s0 = vdupq_n_f32(0.0f);
+    float32x4_t s1 = vdupq_n_f32(0.0f);
+    for (int i = 0; i < n; i += 8) {
+        s0 = vmlaq_f32(s0, vld1q_f32(x + i),     vld1q_f32(a + i));
+        s1 = vmlaq_f32(s1, vld1q_f32(x + i + 4), vld1q_f32(a + i + 4));
+    }
+    float t[4];
+    vst1q_f32(t, vaddq_f32(s0, s1));
+    return (t[0] + t[1]) + (t[2] + t[3]);
+#else
+    float s[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < n; i += 4) {
+        for (int k = 0; k < 4; ++k) {
+            s[k] += x[i + k]*a[i + k];
+        }
+    }
+    return (s[0] + s[1]) + (s[2] + s[3]);
+#endif
+}
+
+// Dot products of x with a and with b, n must be a multiple of 8
+inline void dotProducts(const float * x, const float * a, const float * b, int n, float & resA, float & resB) {
+#if defined(GGWAVE_SSE)
+    __m128 sa0 = _mm_setzero_ps();
+    __m128 sa1 = _mm_setzero_ps();
+    __m128 sb0 = _mm_setzero_ps();
+    __m128 sb1 = _mm_setzero_ps();
+    for (int i = 0; i < n; i += 8) {
+        const __m128 x0 = _mm_loadu_ps(x + i);
+        const __m128 x1 = _mm_loadu_ps(x + i + 4);
+        sa0 = _mm_add_ps(sa0, _mm_mul_ps(x0, _mm_loadu_ps(a + i)));
+        sa1 = _mm_add_ps(sa1, _mm_mul_ps(x1, _mm_loadu_ps(a + i + 4)));
+        sb0 = _mm_add_ps(sb0, _mm_mul_ps(x0, _mm_loadu_ps(b + i)));
+        sb1 = _mm_add_ps(sb1, _mm_mul_ps(x1, _mm_loadu_ps(b + i + 4)));
+    }
+    float ta[4];
+    float tb[4];
+    _mm_storeu_ps(ta, _mm_add_ps(sa0, sa1));
+    _mm_storeu_ps(tb, _mm_add_ps(sb0, sb1));
+    resA = (ta[0] + ta[1]) + (ta[2] + ta[3]);
+    resB = (tb[0] + tb[1]) + (tb[2] + tb[3]);
+#elif defined(GGWAVE_NEON)
+    float32x4_t sa0 = vdupq_n_f32(0.0f);
+    float32x4_t sa1 = vdupq_n_f32(0.0f);
+    float32x4_t sb0 = vdupq_n_f32(0.0f);
+    float32x4_t sb1 = vdupq_n_f32(0.0f);
+    for (int i = 0; i < n; i += 8) {
+        const float32x4_t x0 = vld1q_f32(x + i);
+        const float32x4_t x1 = vld1q_f32(x + i + 4);
+        sa0 = vmlaq_f32(sa0, x0, vld1q_f32(a + i));
+        sa1 = vmlaq_f32(sa1, x1, vld1q_f32(a + i + 4));
+        sb0 = vmlaq_f32(sb0, x0, vld1q_f32(b + i));
+        sb1 = vmlaq_f32(sb1, x1, vld1q_f32(b + i + 4));
+    }
+    float ta[4];
+    float tb[4];
+    vst1q_f32(ta, vaddq_f32(sa0, sa1));
+    vst1q_f32(tb, vaddq_f32(sb0, sb1));
+    resA = (ta[0] + ta[1]) + (ta[2] + ta[3]);
+    resB = (tb[0] + tb[1]) + (tb[2] + tb[3]);
+#else
+    float sa[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float sb[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < n; i += 4) {
+        for (int k = 0; k < 4; ++k) {
+            sa[k] += x[i + k]*a[i + k];
+            sb[k] += x[i + k]*b[i + k];
+        }
+    }
+    resA = (sa[0] + sa[1]) + (sa[2] + sa[3]);
+    resB = (sb[0] + sb[1]) + (sb[2] + sb[3]);
+#endif
+}
+
+// Hann-windowed sinc with the given number of zero crossings on each side
+inline double windowedSinc(double x, int width) {
+    if (fabs(x) >= width - 1) {
+        return 0.0;
+    }
+
+    if (x == 0.0) {
+        return 1.0;
+    }
+
+    return sin(M_PI*x)/(M_PI*x)*(0.5 + 0.5*cos(M_PI*x/width));
+}
+
+inline int gcd(int a, int b) {
+    while (b != 0) {
+        const int t = a % b;
+        a = b;
+        b = t;
+    }
+
+    return a;
+}
+
+GGWave::Resampler::Resampler() {}
+
+bool GGWave::Resampler::alloc(void * p, int & n, float sampleRateInp, float sampleRateOut) {
+    m_factor = sampleRateInp/sampleRateOut;
+
+    // exact ratio L/M of integer sample rates
+    const int rateInp = sampleRateInp;
+    const int rateOut = sampleRateOut;
+    const int g = (rateInp > 0 && rateOut > 0) ? ::gcd(rateInp, rateOut) : 1;
 
-bool GGWave::Resampler::alloc(void * p, int & n) {
-    ggalloc(m_sincTable,   kWidth*kSamplesPerZeroCrossing, p, n);
-    ggalloc(m_delayBuffer, 3*kWidth, p, n);
-    ggalloc(m_edgeSamples, kWidth, p, n);
-    ggalloc(m_samplesInp,  4096, p, n);
+    m_isExact = rateInp == sampleRateInp && rateOut == sampleRateOut && rateOut/g <= kMaxPhasesExact;
+
+    if (m_isExact) {
+        m_step      = rateInp/g;
+        m_timeScale = rateOut/g;
+    } else {
+        m_timeScale = kPhases << kPhaseBits;
+        m_step      = (int64_t) ((double) sampleRateInp/sampleRateOut*m_timeScale + 0.5);
+    }
+
+    ggalloc(m_banks,   m_isExact ? m_timeScale : kPhases + 1, kTaps, p, n);
+    ggalloc(m_history, 2*kTaps, p, n);
 
     if (p) {
-        makeSinc();
+        makeBanks();
         reset();
     }
 
@@ -1425,145 +2303,297 @@ bool GGWave::Resampler::alloc(void * p, int & n) {
 
 void GGWave::Resampler::reset() {
     m_state = {};
-    m_edgeSamples.zero();
-    m_delayBuffer.zero();
-    m_samplesInp.zero();
+    m_history.zero();
+}
+
+// the j-th next output sample needs nSkip + floor((phase + j*step)/timeScale) input samples
+
+int GGWave::Resampler::predictOutputSamples(int nSamplesInp) const {
+    if (nSamplesInp < m_state.nSkip) {
+        return 0;
+    }
+
+    return ((nSamplesInp - m_state.nSkip + 1)*m_timeScale - m_state.phase + m_step - 1)/m_step;
+}
+
+int GGWave::Resampler::predictInputSamples(int nSamplesOut) const {
+    if (nSamplesOut <= 0) {
+        return 0;
+    }
+
+    return m_state.nSkip + (m_state.phase + (nSamplesOut - 1)*m_step)/m_timeScale;
 }
 
 int GGWave::Resampler::resample(
-        float factor,
         int nSamples,
         const float * samplesInp,
         float * samplesOut) {
-    int idxInp = -1;
+    int idxInp = 0;
     int idxOut = 0;
-    int notDone = 1;
-    float data_in = 0.0f;
-    float data_out = 0.0f;
-    double one_over_factor = 1.0;
-
-    auto stateSave = m_state;
 
-    m_state.nSamplesTotal += nSamples;
-
-    if (samplesOut) {
-        assert(nSamples > kWidth);
-        assert((int) m_samplesInp.size() >= nSamples + kWidth);
-        //if ((int) m_samplesInp.size() < nSamples + kWidth) {
-        //    m_samplesInp.resize(nSamples + kWidth);
-        //}
-        for (int i = 0; i < kWidth; ++i) {
-            m_samplesInp[i] = m_edgeSamples[i];
-            m_edgeSamples[i] = samplesInp[nSamples - kWidth + i];
-        }
-        for (int i = 0; i < nSamples; ++i) {
-            m_samplesInp[i + kWidth] = samplesInp[i];
-        }
-        samplesInp = m_samplesInp.data();
-    }
+    float * history = m_history.data();
 
-    while (notDone) {
-        while (m_state.timeLast < m_state.timeInt) {
-            if (++idxInp >= nSamples) {
-                notDone = 0;
-                break;
-            } else {
-                data_in = samplesInp[idxInp];
+    while (true) {
+        // consume the input samples up to the time of the next output sample
+        // the history is needed only while the taps extend before the start of samplesInp
+        const int nConsume = GG_MIN(m_state.nSkip, nSamples - idxInp);
+        for (int i = idxInp; i < GG_MIN(idxInp + nConsume, kTaps); ++i) {
+            history[m_state.historyPos]         = samplesInp[i];
+            history[m_state.historyPos + kTaps] = samplesInp[i];
+            if (++m_state.historyPos == kTaps) {
+                m_state.historyPos = 0;
             }
-            //printf("xxxx idxInp = %d\n", idxInp);
-            if (samplesOut) newData(data_in);
-            m_state.timeLast += 1;
         }
 
-        if (notDone == false) break;
+        idxInp += nConsume;
+        m_state.nSkip -= nConsume;
 
-        double temp1 = 0.0;
-        int left_limit = m_state.timeNow - kWidth + 1; /* leftmost neighboring sample used for interp.*/
-        int right_limit = m_state.timeNow + kWidth;    /* rightmost leftmost neighboring sample used for interp.*/
-        if (left_limit < 0) left_limit = 0;
-        if (right_limit > m_state.nSamplesTotal + kWidth) right_limit = m_state.nSamplesTotal + kWidth;
-        if (factor < 1.0) {
-            for (int j = left_limit; j < right_limit; j++) {
-                temp1 += getData(j - m_state.timeInt)*sinc(m_state.timeNow - (double) j);
-            }
-            data_out = temp1;
+        if (m_state.nSkip > 0) {
+            break;
         }
-        else {
-            one_over_factor = 1.0 / factor;
-            for (int j = left_limit; j < right_limit; j++) {
-                temp1 += getData(j - m_state.timeInt)*one_over_factor*sinc(one_over_factor*(m_state.timeNow - (double) j));
+
+        if (m_isExact && m_timeScale == 1 && idxInp >= kTaps) {
+            // integer ratio - decimate directly from the input
+            const float * bank = m_banks[0].data();
+            while (true) {
+                samplesOut[idxOut++] = ::dotProduct(samplesInp + idxInp - kTaps, bank, kTaps);
+                if (idxInp + m_step > nSamples) {
+                    break;
+                }
+                idxInp += m_step;
             }
-            data_out = temp1;
+
+            m_state.nSkip = m_step;
+            continue;
         }
 
-        if (samplesOut) {
-            //printf("inp = %d, l = %d, r = %d, n = %d, a = %d, b = %d\n", idxInp, left_limit, right_limit, m_state.nSamplesTotal, left_limit - m_state.timeInt, right_limit - m_state.timeInt - 1);
-            samplesOut[idxOut] = data_out;
+        // the last kTaps input samples
+        const float * x = idxInp >= kTaps ? samplesInp + idxInp - kTaps : history + m_state.historyPos;
+
+        if (m_isExact) {
+            samplesOut[idxOut] = ::dotProduct(x, m_banks[m_state.phase].data(), kTaps);
+        } else {
+            const int bank = m_state.phase >> kPhaseBits;
+            const float w = (m_state.phase & ((1 << kPhaseBits) - 1))*(1.0f/(1 << kPhaseBits));
+
+            float a = 0.0f;
+            float b = 0.0f;
+            ::dotProducts(x, m_banks[bank].data(), m_banks[bank + 1].data(), kTaps, a, b);
+
+            samplesOut[idxOut] = a + w*(b - a);
         }
         ++idxOut;
 
-        m_state.timeNow += factor;
-        m_state.timeLast = m_state.timeInt;
-        m_state.timeInt = m_state.timeNow;
-        while (m_state.timeLast < m_state.timeInt) {
-            if (++idxInp >= nSamples) {
-                notDone = 0;
-                break;
-            } else {
-                data_in = samplesInp[idxInp];
-            }
-            if (samplesOut) newData(data_in);
-            m_state.timeLast += 1;
-        }
-        //printf("last idxInp = %d, nSamples = %d\n", idxInp, nSamples);
+        m_state.phase += m_step;
+        m_state.nSkip  = m_state.phase/m_timeScale;
+        m_state.phase -= m_state.nSkip*m_timeScale;
     }
 
-    if (samplesOut == nullptr) {
-        m_state = stateSave;
+    // keep the last kTaps input samples for the next call
+    if (nSamples >= kTaps) {
+        for (int i = 0; i < kTaps; ++i) {
+            history[i]         = samplesInp[nSamples - kTaps + i];
+            history[i + kTaps] = samplesInp[nSamples - kTaps + i];
+        }
+        m_state.historyPos = 0;
     }
 
     return idxOut;
 }
 
-float GGWave::Resampler::getData(int j) const {
-    return m_delayBuffer[(int) j + kWidth];
+void GGWave::Resampler::makeBanks() {
+    // when downsampling, the cutoff is lowered to the Nyquist frequency of the output
+    const double scale = m_factor < 1.0f ? 1.0 : 1.0/m_factor;
+
+    for (int phase = 0; phase < m_banks.size(); ++phase) {
+        auto bank = m_banks[phase];
+
+        // fractional delay of the bank in input samples
+        const double delay = m_isExact ? (double) phase/m_timeScale : (double) phase/kPhases;
+
+        for (int i = 0; i < kTaps; ++i) {
+            // distance in input samples between the output sample and the i-th sample of the history
+            const double x = delay + kWidth - i;
+            bank[i] = scale*::windowedSinc(scale*x, kWidth);
+        }
+    }
 }
 
-void GGWave::Resampler::newData(float data) {
-    for (int i = 0; i < kDelaySize - 5; i++) {
-        m_delayBuffer[i] = m_delayBuffer[i + 1];
+//
+// Variable payload length
+//
+
+//
+// Sliding DFT
+//
+
+GGWave::SlidingDFT::SlidingDFT() {}
+
+bool GGWave::SlidingDFT::alloc(void * p, int & n, int N, int nHops, int maxBins) {
+    if (N <= 0 || nHops <= 0 || N % nHops != 0 || maxBins <= 0) {
+        ggprintf("Invalid sliding DFT parameters: N = %d, nHops = %d, maxBins = %d\n", N, nHops, maxBins);
+        return false;
     }
-    m_delayBuffer[kDelaySize - 5] = data;
+
+    m_N       = N;
+    m_nHops   = nHops;
+    m_hopSize = N/nHops;
+    m_maxBins = maxBins;
+    m_nBins   = 0;
+    m_nPushed = 0;
+
+    ggalloc(m_cosTable,  N, p, n);
+    ggalloc(m_bins,      maxBins, p, n);
+    ggalloc(m_twiddles,  m_hopSize, 2*maxBins, p, n);
+    ggalloc(m_rotations, maxBins, 2*nHops, p, n);
+    ggalloc(m_hops,      nHops, 2*maxBins, p, n);
+    ggalloc(m_acc,       2*maxBins, p, n);
+    ggalloc(m_output,    2*maxBins, p, n);
+
+    if (p) {
+        for (int i = 0; i < N; ++i) {
+            m_cosTable[i] = cos((2.0*M_PI*i)/N);
+        }
+    }
+
+    return true;
 }
 
-void GGWave::Resampler::makeSinc() {
-    double temp, win_freq, win;
-    win_freq = M_PI/kWidth/kSamplesPerZeroCrossing;
-    m_sincTable[0] = 1.0;
-    for (int i = 1; i < kWidth*kSamplesPerZeroCrossing; i++) {
-        temp = (double) i*M_PI/kSamplesPerZeroCrossing;
-        m_sincTable[i] = sin(temp)/temp;
-        win = 0.5 + 0.5*cos(win_freq*i);
-        m_sincTable[i] *= win;
+bool GGWave::SlidingDFT::setBins(const int * bins, int nBins) {
+    if (nBins > m_maxBins) {
+        ggprintf("Too many sliding DFT bins: %d, max: %d\n", nBins, m_maxBins);
+        return false;
+    }
+
+    m_nBins = nBins;
+    for (int i = 0; i < nBins; ++i) {
+        m_bins[i] = bins[i];
     }
+
+    setTwiddles();
+    reset();
+
+    return true;
 }
 
-double GGWave::Resampler::sinc(double x) const {
-    int low;
-    double temp, delta;
-    if (fabs(x) >= kWidth - 1) {
-        return 0.0;
-    } else {
-        temp = fabs(x)*(double) kSamplesPerZeroCrossing;
-        low = temp;          /* these are interpolation steps */
-        delta = temp - low;  /* and can be ommited if desired */
-        return linear_interp(m_sincTable[low], m_sincTable[low + 1], delta);
+bool GGWave::SlidingDFT::setBins(int binStart, int nBins) {
+    if (nBins > m_maxBins) {
+        ggprintf("Too many sliding DFT bins: %d, max: %d\n", nBins, m_maxBins);
+        return false;
     }
+
+    m_nBins = nBins;
+    for (int i = 0; i < nBins; ++i) {
+        m_bins[i] = binStart + i;
+    }
+
+    setTwiddles();
+    reset();
+
+    return true;
 }
 
-//
-// Variable payload length
-//
+void GGWave::SlidingDFT::reset() {
+    m_nPushed = 0;
+}
+
+void GGWave::SlidingDFT::setTwiddles() {
+    // exp(2*pi*i*x/N), using the cos table and sin(x) = cos(x + 3*pi/2)
+    const auto wrap = [this](int x) { return x < m_N ? x : x - m_N; };
+    const int shift = 3*m_N/4;
+
+    for (int b = 0; b < m_nBins; ++b) {
+        const int step    = m_bins[b] % m_N;
+        const int stepHop = (int) (((int64_t) step*m_hopSize) % m_N);
+
+        for (int j = 0, x = 0; j < m_hopSize; ++j, x = wrap(x + step)) {
+            m_twiddles[j][b]           = m_cosTable[x];
+            m_twiddles[j][m_nBins + b] = m_cosTable[wrap(x + shift)];
+        }
+
+        float * rot = m_rotations[b].data();
+        for (int q = 0, x = 0; q < m_nHops; ++q, x = wrap(x + stepHop)) {
+            rot[2*q + 0] = m_cosTable[x];
+            rot[2*q + 1] = m_cosTable[wrap(x + shift)];
+        }
+    }
+}
+
+bool GGWave::SlidingDFT::push(const float * hop) {
+    // spectrum of the new hop - the loop over the bins is the inner one, so it can be vectorized
+    float * accRe = m_acc.data();
+    float * accIm = m_acc.data() + m_nBins;
+    for (int b = 0; b < 2*m_nBins; ++b) {
+        accRe[b] = 0.0f;
+    }
+
+    for (int j = 0; hop && j < m_hopSize; ++j) {
+        const float x = hop[j];
+        const float * twRe = m_twiddles[j].data();
+        const float * twIm = twRe + m_nBins;
+        for (int b = 0; b < m_nBins; ++b) {
+            accRe[b] += x*twRe[b];
+            accIm[b] += x*twIm[b];
+        }
+    }
+
+    // the new hop replaces the oldest one
+    const int slot = m_nPushed % m_nHops;
+    const int window = m_nPushed - m_nHops + 1;
+
+    float * y = m_hops[slot].data();
+
+    if (window > 0 && window % kAnchorHops != 0) {
+        // X_w = exp(-2*pi*i*bin/K)*(X_{w-1} - Y_{w-1} + Y_{w+K-1})
+        for (int b = 0; b < m_nBins; ++b) {
+            const float re = m_output[2*b + 0] - y[2*b + 0] + accRe[b];
+            const float im = m_output[2*b + 1] - y[2*b + 1] + accIm[b];
+
+            const float rRe =  m_rotations[b][2];
+            const float rIm = -m_rotations[b][3];
+
+            m_output[2*b + 0] = re*rRe - im*rIm;
+            m_output[2*b + 1] = re*rIm + im*rRe;
+        }
+    }
+
+    for (int b = 0; b < m_nBins; ++b) {
+        y[2*b + 0] = accRe[b];
+        y[2*b + 1] = accIm[b];
+    }
+
+    ++m_nPushed;
+
+    if (window < 0) {
+        return false;
+    }
+
+    if (window % kAnchorHops == 0) {
+        anchor();
+    }
+
+    return true;
+}
+
+void GGWave::SlidingDFT::anchor() {
+    // X_w = sum_q exp(2*pi*i*bin*q/K)*Y_{w+q}
+    const int window = m_nPushed - m_nHops;
+
+    for (int b = 0; b < m_nBins; ++b) {
+        const float * rot = m_rotations[b].data();
+
+        float re = 0.0f;
+        float im = 0.0f;
+        for (int q = 0; q < m_nHops; ++q) {
+            const float * y = m_hops[(window + q) % m_nHops].data() + 2*b;
+            re += rot[2*q + 0]*y[0] - rot[2*q + 1]*y[1];
+            im += rot[2*q + 0]*y[1] + rot[2*q + 1]*y[0];
+        }
+
+        m_output[2*b + 0] = re;
+        m_output[2*b + 1] = im;
+    }
+}
 
 void GGWave::decode_variable() {
     m_rx.amplitudeHistory[m_rx.historyId].copy(m_rx.amplitude);
@@ -1588,287 +2618,756 @@ void GGWave::decode_variable() {
             m_rx.amplitudeAverage[i] *= norm;
         }
 
-        // calculate spectrum
-        FFT(m_rx.amplitudeAverage.data(), m_rx.fftOut.data(), m_samplesPerFrame, m_rx.fftWorkI.data(), m_rx.fftWorkF.data());
-
-        for (int i = 0; i < m_samplesPerFrame; ++i) {
-            m_rx.spectrum[i] = (m_rx.fftOut[2*i + 0]*m_rx.fftOut[2*i + 0] + m_rx.fftOut[2*i + 1]*m_rx.fftOut[2*i + 1]);
-        }
-        for (int i = 1; i < m_samplesPerFrame/2; ++i) {
-            m_rx.spectrum[i] += m_rx.spectrum[m_samplesPerFrame - i];
+        // while idle, compute the full spectrum only if some of the protocols could have a marker
+        if (m_rx.receiving || detectMarkerSparse()) {
+            updateSpectrum();
+        } else {
+            m_rx.isSpectrumStale = true;
         }
     }
 
     if (m_rx.framesLeftToRecord > 0) {
-        memcpy(m_rx.amplitudeRecorded.data() + (m_rx.framesToRecord - m_rx.framesLeftToRecord)*m_samplesPerFrame,
+        const int nRecordedFrames = m_rx.amplitudeRecorded.size()/m_samplesPerFrame;
+
+        memcpy(m_rx.amplitudeRecorded.data() + (m_rx.nFramesRecorded % nRecordedFrames)*m_samplesPerFrame,
                m_rx.amplitude.data(),
                m_samplesPerFrame*sizeof(float));
 
+        ++m_rx.nFramesRecorded;
+
         if (--m_rx.framesLeftToRecord <= 0) {
-            m_rx.analyzing = true;
+            // there is a single analysis at a time - the recording waits until the previous one completes
+            // the recorded data is kept, since no new reception can start while receiving
+            if (m_rx.analyzing) {
+                m_rx.isAnalysisQueued = true;
+            } else {
+                startAnalysis();
+            }
+        } else {
+            const int nFramesRecorded = m_rx.framesToRecord - m_rx.framesLeftToRecord;
+
+            // spectra of all steps that are fully recorded
+            if (m_rx.banks[m_rx.bankRecord].nCandidates > 0) {
+                advanceSteps((nFramesRecorded - 1)*kStepsPerFrame);
+            }
+
+            // decode the Txs that have been fully recorded so far
+            decode_candidates(nFramesRecorded);
         }
     }
 
     if (m_rx.analyzing) {
-        ggprintf("Analyzing captured data ..\n");
+        // in amortized mode, each captured frame advances the analysis a bit
+        // an analysis that still needs the recording keeps the reception waiting until it completes
+        analyze(m_isRxAmortized ? kDefaultRxStepBudget_us : -1);
+    }
 
-        const int stepsPerFrame = 16;
-        const int step = m_samplesPerFrame/stepsPerFrame;
+    // check if receiving data
+    if (m_rx.receiving == false && m_rx.isSpectrumStale == false) {
+        bool isReceiving = false;
 
-        bool isValid = false;
-        for (int protocolId = 0; protocolId < (int) m_rx.protocols.size(); ++protocolId) {
-            const auto & protocol = m_rx.protocols[protocolId];
+        for (int i = 0; i < m_rx.protocols.size(); ++i) {
+            const auto & protocol = m_rx.protocols[i];
             if (protocol.enabled == false) {
                 continue;
             }
 
-            // skip Rx protocol if it is mono-tone
-            if (protocol.extra == 2) {
-                continue;
+            int nDetectedMarkerBits = m_nBitsInMarker;
+
+            for (int i = 0; i < m_nBitsInMarker; ++i) {
+                double freq = bitFreq(protocol, i);
+                int bin = round(freq*m_ihzPerSample);
+
+                if (i%2 == 0) {
+                    if (m_rx.spectrum[bin] <= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) --nDetectedMarkerBits;
+                } else {
+                    if (m_rx.spectrum[bin] >= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) --nDetectedMarkerBits;
+                }
+            }
+
+            if (nDetectedMarkerBits == m_nBitsInMarker) {
+                m_rx.markerFreqStart = protocol.freqStart;
+                isReceiving = true;
+                break;
+            }
+        }
+
+        if (isReceiving) {
+            if (++m_rx.nMarkersSuccess >= 1) {
+            } else {
+                isReceiving = false;
+            }
+        } else {
+            m_rx.nMarkersSuccess = 0;
+        }
+
+        if (isReceiving) {
+            ggprintf("Receiving sound data ...\n");
+
+            m_rx.receiving = true;
+
+            // max recieve duration
+            m_rx.recvDuration_frames =
+                2*m_nMarkerFrames +
+                maxFramesPerTx(m_rx.protocols, true)*(
+                        (kMaxLengthVariable + ::getECCBytesForLength(kMaxLengthVariable))/minBytesPerTx(m_rx.protocols) + 1
+                        );
+
+            m_rx.nMarkersSuccess = 0;
+            m_rx.framesToRecord = m_rx.recvDuration_frames;
+            m_rx.framesLeftToRecord = m_rx.recvDuration_frames;
+
+            // start a new search for each protocol that could have produced the detected marker
+            const int nOffsets = m_nMarkerFrames*kStepsPerFrame;
+
+            auto & bank = m_rx.banks[m_rx.bankRecord];
+
+            bank.nCandidates = 0;
+            m_rx.stepBinCount = 0;
+            for (int protocolId = 0; protocolId < m_rx.protocols.size(); ++protocolId) {
+                const auto & protocol = m_rx.protocols[protocolId];
+                if (protocol.enabled == false) {
+                    continue;
+                }
+
+                // skip Rx protocol if it is mono-tone
+                if (protocol.extra == 2) {
+                    continue;
+                }
+
+                // skip Rx protocol if start frequency is different from detected one
+                if (protocol.freqStart != m_rx.markerFreqStart) {
+                    continue;
+                }
+
+                if (bank.nCandidates + nOffsets > bank.candidates.size()) {
+                    ggprintf("Warning: too many Rx protocols with start frequency %d\n", protocol.freqStart);
+                    break;
+                }
+
+                for (int ii = 0; ii < nOffsets; ++ii) {
+                    auto & candidate = bank.candidates[bank.nCandidates++];
+
+                    candidate.state         = kCandidatePending;
+                    candidate.protocolId    = protocolId;
+                    candidate.offset        = ii;
+                    candidate.itx           = 0;
+                    candidate.decodedLength = 0;
+                }
+
+                m_rx.stepBinCount = GG_MAX(m_rx.stepBinCount, 2*16*protocol.bytesPerTx);
             }
 
-            // skip Rx protocol if start frequency is different from detected one
-            if (protocol.freqStart != m_rx.markerFreqStart) {
+            bank.candidatesData.zero();
+            bank.candidatesConfidence.zero();
+
+            m_rx.stepBinStart = round(m_hzPerSample*m_rx.markerFreqStart*m_ihzPerSample);
+            m_rx.nFramesRecorded = 0;
+            m_rx.stepHopNext = 0;
+            m_rx.stepDFT.setBins(m_rx.stepBinStart, m_rx.stepBinCount);
+            for (int i = 0; i < bank.stepSpectrumId.size(); ++i) {
+                bank.stepSpectrumId[i] = -1;
+            }
+
+            bank.stats = {};
+        }
+    } else if (m_rx.receiving && m_rx.framesLeftToRecord > 0) {
+        bool isEnded = false;
+
+        for (int i = 0; i < m_rx.protocols.size(); ++i) {
+            const auto & protocol = m_rx.protocols[i];
+            if (protocol.enabled == false) {
                 continue;
             }
 
-            m_rx.spectrum.zero();
+            int nDetectedMarkerBits = m_nBitsInMarker;
+
+            for (int i = 0; i < m_nBitsInMarker; ++i) {
+                double freq = bitFreq(protocol, i);
+                int bin = round(freq*m_ihzPerSample);
+
+                if (i%2 == 0) {
+                    if (m_rx.spectrum[bin] >= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) nDetectedMarkerBits--;
+                } else {
+                    if (m_rx.spectrum[bin] <= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) nDetectedMarkerBits--;
+                }
+            }
+
+            if (nDetectedMarkerBits == m_nBitsInMarker) {
+                isEnded = true;
+                break;
+            }
+        }
+
+        if (isEnded) {
+            if (++m_rx.nMarkersSuccess >= 1) {
+            } else {
+                isEnded = false;
+            }
+        } else {
+            m_rx.nMarkersSuccess = 0;
+        }
+
+        if (isEnded && m_rx.framesToRecord > 1) {
+            m_rx.recvDuration_frames -= m_rx.framesLeftToRecord - 1;
+            ggprintf("Received end marker. Frames left = %d, recorded = %d\n", m_rx.framesLeftToRecord, m_rx.recvDuration_frames);
+            m_rx.nMarkersSuccess = 0;
+            m_rx.framesLeftToRecord = 1;
+        }
+    }
+}
+
+bool GGWave::detectMarkerSparse() {
+    if (m_samplesPerFrame % kGoertzelBlocks != 0) {
+        return true;
+    }
+
+    // relax the threshold, so that the difference between the Goertzel and the FFT results
+    // cannot lead to a missed marker
+    const float thresholdLo = 0.8f*m_soundMarkerThreshold;
+    const float thresholdHi = 1.25f*m_soundMarkerThreshold;
+
+    const int nPerBlock = m_samplesPerFrame/kGoertzelBlocks;
+    for (int m = 0; m < kGoertzelBlocks; ++m) {
+        for (int i = 0; i < nPerBlock; ++i) {
+            m_rx.amplitudeMarker[i*kGoertzelBlocks + m] = m_rx.amplitudeAverage[m*nPerBlock + i];
+        }
+    }
+
+    for (int i = 0; i < m_rx.protocols.size(); ++i) {
+        const auto & protocol = m_rx.protocols[i];
+        if (protocol.enabled == false) {
+            continue;
+        }
+
+        // the marker bins depend only on the start frequency
+        bool isChecked = false;
+        for (int j = 0; j < i; ++j) {
+            if (m_rx.protocols[j].enabled && m_rx.protocols[j].freqStart == protocol.freqStart) {
+                isChecked = true;
+                break;
+            }
+        }
+        if (isChecked) {
+            continue;
+        }
+
+        // the even bits are much less likely to pass on noise, so check them first
+        int nDetectedMarkerBits = 0;
+        for (int k = 0; k < m_nBitsInMarker; ++k) {
+            const int b = k < m_nBitsInMarker/2 ? 2*k : 2*(k - m_nBitsInMarker/2) + 1;
+            const int bin = round(bitFreq(protocol, b)*m_ihzPerSample);
+
+            float p0 = 0.0f;
+            float p1 = 0.0f;
+            ::goertzelPower(m_rx.amplitudeMarker.data(), m_samplesPerFrame, bin, bin + m_freqDelta_bin, p0, p1);
+
+            if (b%2 == 0) {
+                if (p0 <= thresholdLo*p1) break;
+            } else {
+                if (p0 >= thresholdHi*p1) break;
+            }
+
+            ++nDetectedMarkerBits;
+        }
+
+        if (nDetectedMarkerBits == m_nBitsInMarker) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void GGWave::updateSpectrum() {
+    FFT(m_rx.amplitudeAverage.data(), m_rx.fftOut.data(), m_samplesPerFrame);
+    if (m_rx.receiving) {
+        ++m_rx.banks[m_rx.bankRecord].stats.nFFT;
+    }
+
+    for (int i = 0; i < m_samplesPerFrame; ++i) {
+        m_rx.spectrum[i] = (m_rx.fftOut[2*i + 0]*m_rx.fftOut[2*i + 0] + m_rx.fftOut[2*i + 1]*m_rx.fftOut[2*i + 1]);
+    }
+    for (int i = 1; i < m_samplesPerFrame/2; ++i) {
+        m_rx.spectrum[i] += m_rx.spectrum[m_samplesPerFrame - i];
+    }
+
+    m_rx.isSpectrumStale = false;
+}
+
+void GGWave::decode_candidates(int nFramesRecorded) {
+    struct Context {
+        GGWave * self;
+        int nFramesRecorded;
+        int nTasks;
+    };
+
+    auto & bank = m_rx.banks[m_rx.bankRecord];
+    bank.recvDuration_frames = m_rx.recvDuration_frames;
+
+    // the workers can share the step spectra only if no new ones have to be computed
+    int nTasks = m_nWorkers;
+    if (nTasks > 1) {
+        int stepIdFirst = nFramesRecorded*kStepsPerFrame;
+        for (int id = 0; id < bank.nCandidates; ++id) {
+            const auto & candidate = bank.candidates[id];
+            if (candidate.state == kCandidatePending) {
+                const auto & protocol = m_rx.protocols[candidate.protocolId];
+                stepIdFirst = GG_MIN(stepIdFirst, candidate.offset + candidate.itx*protocol.framesPerTx*kStepsPerFrame);
+            }
+        }
+
+        if (isStepRangeCached(m_rx.bankRecord, stepIdFirst, (nFramesRecorded - 1)*kStepsPerFrame) == false) {
+            nTasks = 1;
+        }
+    }
+
+    Context context = { this, nFramesRecorded, nTasks };
+
+    runTasks([](void * data, int taskId) {
+        const auto & ctx = *(const Context *) data;
+        const int bankId = ctx.self->m_rx.bankRecord;
+        for (int id = taskId; id < ctx.self->m_rx.banks[bankId].nCandidates; id += ctx.nTasks) {
+            ctx.self->decode_candidate(bankId, id, ctx.nFramesRecorded, taskId);
+        }
+    }, &context, nTasks, bank.stats);
+}
+
+void GGWave::startAnalysis() {
+    ggprintf("Analyzing captured data ..\n");
+
+    // if possible, let the next transmission be recorded in the other bank during the analysis
+    if (beginAnalysis()) {
+        m_rx.bankRecord ^= 1;
+
+        m_rx.receiving = false;
+        m_rx.framesToRecord = 0;
+    }
+}
+
+bool GGWave::beginAnalysis() {
+    auto & bank = m_rx.banks[m_rx.bankRecord];
+    bank.recvDuration_frames = m_rx.recvDuration_frames;
+
+    m_rx.analyzing   = true;
+    m_rx.bankAnalyze = m_rx.bankRecord;
+
+    m_rx.framesToAnalyze     = bank.nCandidates;
+    m_rx.framesLeftToAnalyze = bank.nCandidates;
+
+    // finishing the candidates needs the spectra up to the last step of the last Tx that starts
+    // before the end of the recording
+    int stepIdFirst = bank.recvDuration_frames*kStepsPerFrame;
+    int stepIdLast  = -1;
+    for (int id = 0; id < bank.nCandidates; ++id) {
+        const auto & candidate = bank.candidates[id];
+        if (candidate.state == kCandidatePending) {
+            const auto & protocol = m_rx.protocols[candidate.protocolId];
+            stepIdFirst = GG_MIN(stepIdFirst, candidate.offset + candidate.itx*protocol.framesPerTx*kStepsPerFrame);
+            stepIdLast  = GG_MAX(stepIdLast, (bank.recvDuration_frames + protocol.framesPerTx - 1)*kStepsPerFrame - 1);
+        }
+    }
+
+    if (stepIdFirst > stepIdLast) {
+        return true;
+    }
+
+    // with all of them cached, the analysis no longer needs the recorded data
+    advanceSteps(stepIdLast);
+
+    return isStepRangeCached(m_rx.bankAnalyze, stepIdFirst, stepIdLast);
+}
+
+void GGWave::analyze(int budget_us) {
+    const int64_t tStart = budget_us >= 0 ? ::timestamp_us() : 0;
+
+    const auto & bank = m_rx.banks[m_rx.bankAnalyze];
+
+    // in amortized mode, a piece of work is a single candidate for each worker
+    const int nPerStep = m_isRxAmortized ? m_nWorkers : GG_MAX(1, bank.nCandidates);
+
+    bool isValid = false;
+    while (true) {
+        const int iBegin = m_rx.framesToAnalyze - m_rx.framesLeftToAnalyze;
+        const int iEnd   = GG_MIN(bank.nCandidates, iBegin + nPerStep);
+
+        if (decode_final(iBegin, iEnd)) {
+            isValid = true;
+            break;
+        }
+
+        m_rx.framesLeftToAnalyze = bank.nCandidates - iEnd;
+        if (m_rx.framesLeftToAnalyze <= 0) {
+            break;
+        }
+
+        if (budget_us >= 0 && ::timestamp_us() - tStart >= budget_us) {
+            return;
+        }
+    }
+
+    if (isValid == false) {
+        ggprintf("Failed to capture sound data. Please try again\n");
+        m_rx.dataLength = -1;
+    }
+
+    // the other bank might already be recording the next transmission
+    m_rx.stats = bank.stats;
+
+    m_rx.analyzing = false;
+
+    m_rx.framesToAnalyze = 0;
+    m_rx.framesLeftToAnalyze = 0;
+
+    // the next transmission might already be recorded in the other bank
+    if (m_rx.bankAnalyze == m_rx.bankRecord) {
+        m_rx.receiving = false;
+    }
+
+    if (m_rx.receiving == false) {
+        m_rx.framesToRecord = isValid ? 0 : -1;
+
+        m_rx.spectrum.zero();
+    }
+
+    // the next transmission has been recorded during the analysis
+    if (m_rx.isAnalysisQueued) {
+        m_rx.isAnalysisQueued = false;
+
+        startAnalysis();
+    }
+}
+
+bool GGWave::decode_final(int iBegin, int iEnd) {
+    struct Context {
+        GGWave * self;
+        int iBegin;
+        int iEnd;
+        int nTasks;
+        SharedMinIndex * iDecoded;
+    };
+
+    const int nOffsets = m_nMarkerFrames*kStepsPerFrame;
+
+    const auto & bank = m_rx.banks[m_rx.bankAnalyze];
+
+    // the workers can share the step spectra only if no new ones have to be computed
+    int nTasks = GG_MIN(m_nWorkers, iEnd - iBegin);
+    if (nTasks > 1) {
+        int stepIdFirst = bank.recvDuration_frames*kStepsPerFrame;
+        int stepIdLast  = -1;
+        for (int i = iBegin; i < iEnd; ++i) {
+            const int id = (i/nOffsets)*nOffsets + nOffsets - 1 - i%nOffsets;
+            const auto & candidate = bank.candidates[id];
+            if (candidate.state == kCandidatePending) {
+                const auto & protocol = m_rx.protocols[candidate.protocolId];
+                stepIdFirst = GG_MIN(stepIdFirst, candidate.offset + candidate.itx*protocol.framesPerTx*kStepsPerFrame);
+                stepIdLast  = GG_MAX(stepIdLast, (bank.recvDuration_frames + protocol.framesPerTx - 1)*kStepsPerFrame - 1);
+            }
+        }
+
+        if (isStepRangeCached(m_rx.bankAnalyze, stepIdFirst, stepIdLast) == false) {
+            nTasks = 1;
+        }
+    }
+
+    for (int i = 0; i < nTasks; ++i) {
+        m_rx.workDecoded[i] = -1;
+    }
+
+    SharedMinIndex iDecoded(iEnd);
+    Context context = { this, iBegin, iEnd, nTasks, &iDecoded };
+
+    // each task processes its candidates in the analysis order and stops at the first one that is decoded, or at the
+    // first one that comes after a candidate decoded by another task, since it can no longer win
+    runTasks([](void * data, int taskId) {
+        const auto & ctx = *(const Context *) data;
+        auto & self = *ctx.self;
+        auto & rx = self.m_rx;
+
+        auto & bank = rx.banks[rx.bankAnalyze];
+
+        const int nOffsets = self.m_nMarkerFrames*kStepsPerFrame;
+
+        for (int i = ctx.iBegin + taskId; i < ctx.iEnd; i += ctx.nTasks) {
+            if (i > ctx.iDecoded->load()) {
+                break;
+            }
+
+            // note : not sure if looping backwards here is more meaningful than looping forwards
+            const int id = (i/nOffsets)*nOffsets + nOffsets - 1 - i%nOffsets;
+
+            // finish the Txs that are only partially recorded
+            self.decode_candidate(rx.bankAnalyze, id, -1, taskId);
+
+            const auto & candidate = bank.candidates[id];
+            const auto & protocol = rx.protocols[candidate.protocolId];
+
+            const int decodedLength = candidate.decodedLength;
+
+            bool knownLength = candidate.state == kCandidateComplete && decodedLength > 0;
+            if (knownLength) {
+                const int nTotalBytesExpected = self.m_encodedDataOffset + decodedLength + ::getECCBytesForLength(decodedLength);
+                const int nTotalFramesExpected = 2*self.m_nMarkerFrames + ((nTotalBytesExpected + protocol.bytesPerTx - 1)/protocol.bytesPerTx)*protocol.framesPerTx;
+                if (bank.recvDuration_frames > nTotalFramesExpected ||
+                    bank.recvDuration_frames < nTotalFramesExpected - 2*self.m_nMarkerFrames) {
+                    //printf("  - invalid number of frames: %d (expected %d)\n", bank.recvDuration_frames, nTotalFramesExpected);
+                    knownLength = false;
+                }
+            }
+
+            if (knownLength && i > ctx.iDecoded->load()) {
+                break;
+            }
+
+            if (knownLength) {
+                RS::ReedSolomon rsData(decodedLength, ::getECCBytesForLength(decodedLength), rx.workRSData[taskId].data());
+
+                const int res = ::decodeRS(rsData,
+                                           bank.candidatesData[id].data() + self.m_encodedDataOffset,
+                                           bank.candidatesConfidence[id].data() + self.m_encodedDataOffset,
+                                           rx.workErasures[taskId].data(), rx.workData[taskId].data(), rx.workStats[taskId]);
+
+                if (res == 0) {
+                    rx.workDecoded[taskId] = i;
+                    ctx.iDecoded->lower(i);
+                    break;
+                }
+            }
+        }
+    }, &context, nTasks, m_rx.banks[m_rx.bankAnalyze].stats);
+
+    // the first decoded candidate in the analysis order wins, regardless of the number of tasks
+    int iBest = -1;
+    int taskBest = -1;
+    for (int i = 0; i < nTasks; ++i) {
+        if (m_rx.workDecoded[i] >= 0 && (iBest < 0 || m_rx.workDecoded[i] < iBest)) {
+            iBest = m_rx.workDecoded[i];
+            taskBest = i;
+        }
+    }
+
+    if (iBest < 0) {
+        return false;
+    }
 
-            m_rx.framesToAnalyze = m_nMarkerFrames*stepsPerFrame;
-            m_rx.framesLeftToAnalyze = m_rx.framesToAnalyze;
+    m_rx.framesLeftToAnalyze = bank.nCandidates - iBest;
 
-            // note : not sure if looping backwards here is more meaningful than looping forwards
-            for (int ii = m_nMarkerFrames*stepsPerFrame - 1; ii >= 0; --ii) {
-                bool knownLength = false;
-
-                int decodedLength = 0;
-                const int offsetStart = ii;
-                for (int itx = 0; itx < 1024; ++itx) {
-                    int offsetTx = offsetStart + itx*protocol.framesPerTx*stepsPerFrame;
-                    if (offsetTx >= m_rx.recvDuration_frames*stepsPerFrame || (itx + 1)*protocol.bytesPerTx >= (int) m_dataEncoded.size()) {
-                        break;
-                    }
+    const int id = (iBest/nOffsets)*nOffsets + nOffsets - 1 - iBest%nOffsets;
 
-                    memcpy(m_rx.fftOut.data(),
-                           m_rx.amplitudeRecorded.data() + offsetTx*step,
-                           m_samplesPerFrame*sizeof(float));
+    const auto & candidate = bank.candidates[id];
+    const auto & protocol = m_rx.protocols[candidate.protocolId];
 
-                    // note : should we skip the first and last frame here as they are amplitude-smoothed?
-                    for (int k = 1; k < protocol.framesPerTx; ++k) {
-                        for (int i = 0; i < m_samplesPerFrame; ++i) {
-                            m_rx.fftOut[i] += m_rx.amplitudeRecorded[(offsetTx + k*stepsPerFrame)*step + i];
-                        }
-                    }
+    const int decodedLength = candidate.decodedLength;
 
-                    FFT(m_rx.fftOut.data(), m_samplesPerFrame, m_rx.fftWorkI.data(), m_rx.fftWorkF.data());
+    memcpy(m_rx.data.data(), m_rx.workData[taskBest].data(), decodedLength);
+    m_rx.data[decodedLength] = 0;
 
-                    for (int i = 0; i < m_samplesPerFrame; ++i) {
-                        m_rx.spectrum[i] = (m_rx.fftOut[2*i + 0]*m_rx.fftOut[2*i + 0] + m_rx.fftOut[2*i + 1]*m_rx.fftOut[2*i + 1]);
-                    }
-                    for (int i = 1; i < m_samplesPerFrame/2; ++i) {
-                        m_rx.spectrum[i] += m_rx.spectrum[m_samplesPerFrame - i];
-                    }
+    if (m_isDSSEnabled) {
+        for (int i = 0; i < decodedLength; ++i) {
+            m_rx.data[i] = m_rx.data[i] ^ getDSSMagic(i);
+        }
+    }
 
-                    uint8_t curByte = 0;
-                    for (int i = 0; i < 2*protocol.bytesPerTx; ++i) {
-                        double freq = m_hzPerSample*protocol.freqStart;
-                        int bin = round(freq*m_ihzPerSample) + 16*i;
-
-                        int kmax = 0;
-                        double amax = 0.0;
-                        for (int k = 0; k < 16; ++k) {
-                            if (m_rx.spectrum[bin + k] > amax) {
-                                kmax = k;
-                                amax = m_rx.spectrum[bin + k];
-                            }
-                        }
+    ggprintf("Decoded length = %d, protocol = '%s' (%d)\n", decodedLength, protocol.name, candidate.protocolId);
+    ggprintf("Received sound data successfully: '%s'\n", m_rx.data.data());
 
-                        if (i%2) {
-                            curByte += (kmax << 4);
-                            m_dataEncoded[itx*protocol.bytesPerTx + i/2] = curByte;
-                            curByte = 0;
-                        } else {
-                            curByte = kmax;
-                        }
-                    }
+    m_rx.hasNewRxData = true;
+    m_rx.dataLength = decodedLength;
+    m_rx.protocol = protocol;
+    m_rx.protocolId = RxProtocolId(candidate.protocolId);
 
-                    if (itx*protocol.bytesPerTx > m_encodedDataOffset && knownLength == false) {
-                        RS::ReedSolomon rsLength(1, m_encodedDataOffset - 1, m_workRSLength.data());
-                        if ((rsLength.Decode(m_dataEncoded.data(), m_rx.data.data()) == 0) && (m_rx.data[0] > 0 && m_rx.data[0] <= 140)) {
-                            knownLength = true;
-                            decodedLength = m_rx.data[0];
-                            //printf("decoded length = %d, recvDuration_frames = %d\n", decodedLength, m_rx.recvDuration_frames);
-
-                            const int nTotalBytesExpected = m_encodedDataOffset + decodedLength + ::getECCBytesForLength(decodedLength);
-                            const int nTotalFramesExpected = 2*m_nMarkerFrames + ((nTotalBytesExpected + protocol.bytesPerTx - 1)/protocol.bytesPerTx)*protocol.framesPerTx;
-                            if (m_rx.recvDuration_frames > nTotalFramesExpected ||
-                                m_rx.recvDuration_frames < nTotalFramesExpected - 2*m_nMarkerFrames) {
-                                //printf("  - invalid number of frames: %d (expected %d)\n", m_rx.recvDuration_frames, nTotalFramesExpected);
-                                knownLength = false;
-                                break;
-                            }
-                        } else {
-                            break;
-                        }
-                    }
+    return true;
+}
 
-                    {
-                        const int nTotalBytesExpected = m_encodedDataOffset + decodedLength + ::getECCBytesForLength(decodedLength);
-                        if (knownLength && itx*protocol.bytesPerTx > nTotalBytesExpected + 1) {
-                            break;
-                        }
-                    }
-                }
+void GGWave::runTasks(Executor::Task task, void * taskData, int nTasks, RxStats & stats) {
+    for (int i = 0; i < m_rx.workStats.size(); ++i) {
+        m_rx.workStats[i] = {};
+    }
 
-                if (knownLength) {
-                    RS::ReedSolomon rsData(decodedLength, ::getECCBytesForLength(decodedLength), m_workRSData.data());
+    if (nTasks > 1 && m_executor.run) {
+        m_executor.run(m_executor.userData, task, taskData, nTasks);
+    } else {
+        for (int i = 0; i < nTasks; ++i) {
+            task(taskData, i);
+        }
+    }
 
-                    if (rsData.Decode(m_dataEncoded.data() + m_encodedDataOffset, m_rx.data.data()) == 0) {
-                        if (decodedLength > 0) {
-                            if (m_isDSSEnabled) {
-                                for (int i = 0; i < decodedLength; ++i) {
-                                    m_rx.data[i] = m_rx.data[i] ^ getDSSMagic(i);
-                                }
-                            }
+    for (int i = 0; i < m_rx.workStats.size(); ++i) {
+        const auto & workStats = m_rx.workStats[i];
 
-                            ggprintf("Decoded length = %d, protocol = '%s' (%d)\n", decodedLength, protocol.name, protocolId);
-                            ggprintf("Received sound data successfully: '%s'\n", m_rx.data.data());
+        stats.nRSDecodes   += workStats.nRSDecodes;
+        stats.nRSLocator   += workStats.nRSLocator;
+        stats.nRSChien     += workStats.nRSChien;
+        stats.nRSCorrected += workStats.nRSCorrected;
+        stats.nRSErasures  += workStats.nRSErasures;
+    }
+}
 
-                            isValid = true;
-                            m_rx.hasNewRxData = true;
-                            m_rx.dataLength = decodedLength;
-                            m_rx.protocol = protocol;
-                            m_rx.protocolId = RxProtocolId(protocolId);
-                        }
-                    }
-                }
+void GGWave::decode_candidate(int bankId, int id, int nFramesRecorded, int workerId) {
+    auto & bank = m_rx.banks[bankId];
+    auto & candidate = bank.candidates[id];
+    auto dataEncoded = bank.candidatesData[id];
+    auto confidence  = bank.candidatesConfidence[id];
 
-                if (isValid) {
-                    break;
-                }
-                --m_rx.framesLeftToAnalyze;
-            }
+    const auto & protocol = m_rx.protocols[candidate.protocolId];
 
-            if (isValid) break;
+    while (candidate.state == kCandidatePending) {
+        const int itx = candidate.itx;
+        const int offsetTx = candidate.offset + itx*protocol.framesPerTx*kStepsPerFrame;
+        if (offsetTx >= bank.recvDuration_frames*kStepsPerFrame || (itx + 1)*protocol.bytesPerTx >= dataEncoded.size()) {
+            candidate.state = kCandidateComplete;
+            break;
         }
 
-        m_rx.framesToRecord = 0;
-
-        if (isValid == false) {
-            ggprintf("Failed to capture sound data. Please try again (length = %d)\n", m_rx.data[0]);
-            m_rx.dataLength = -1;
-            m_rx.framesToRecord = -1;
+        // wait for all frames of this Tx to be recorded, unless this is the final pass
+        if (nFramesRecorded >= 0 && offsetTx + protocol.framesPerTx*kStepsPerFrame > nFramesRecorded*kStepsPerFrame) {
+            break;
         }
 
-        m_rx.receiving = false;
-        m_rx.analyzing = false;
+        // the spectrum of the sum of the frames is the sum of the spectra of the frames
+        // note : should we skip the first and last frame here as they are amplitude-smoothed?
+        const int nBins = 2*16*protocol.bytesPerTx;
 
-        m_rx.spectrum.zero();
+        auto spectrumSum = m_rx.stepSpectrumSum[workerId];
+        memcpy(spectrumSum.data(), stepSpectrum(bankId, offsetTx), 2*nBins*sizeof(float));
+        for (int k = 1; k < protocol.framesPerTx; ++k) {
+            const float * spectrum = stepSpectrum(bankId, offsetTx + k*kStepsPerFrame);
+            for (int i = 0; i < 2*nBins; ++i) {
+                spectrumSum[i] += spectrum[i];
+            }
+        }
 
-        m_rx.framesToAnalyze = 0;
-        m_rx.framesLeftToAnalyze = 0;
-    }
+        uint8_t curByte = 0;
+        uint8_t curConfidence = 0;
+        for (int i = 0; i < 2*protocol.bytesPerTx; ++i) {
+            int kmax = 0;
+            double amax = 0.0;
+            double asecond = 0.0;
+            for (int k = 0; k < 16; ++k) {
+                const float re = spectrumSum[2*(16*i + k) + 0];
+                const float im = spectrumSum[2*(16*i + k) + 1];
+                const float power = re*re + im*im;
+                if (power > amax) {
+                    kmax = k;
+                    asecond = amax;
+                    amax = power;
+                } else if (power > asecond) {
+                    asecond = power;
+                }
+            }
 
-    // check if receiving data
-    if (m_rx.receiving == false) {
-        bool isReceiving = false;
+            // peak-to-second-peak ratio, in steps of 1/16
+            const uint8_t nibbleConfidence = amax >= 16.0*asecond ? 255 : (uint8_t) GG_MIN(255.0, 16.0*amax/asecond);
 
-        for (int i = 0; i < m_rx.protocols.size(); ++i) {
-            const auto & protocol = m_rx.protocols[i];
-            if (protocol.enabled == false) {
-                continue;
+            if (i%2) {
+                curByte += (kmax << 4);
+                dataEncoded[itx*protocol.bytesPerTx + i/2] = curByte;
+                confidence[itx*protocol.bytesPerTx + i/2] = GG_MIN(curConfidence, nibbleConfidence);
+                curByte = 0;
+            } else {
+                curByte = kmax;
+                curConfidence = nibbleConfidence;
             }
+        }
 
-            int nDetectedMarkerBits = m_nBitsInMarker;
+        if (itx*protocol.bytesPerTx > m_encodedDataOffset && candidate.decodedLength == 0) {
+            uint8_t length = 0;
 
-            for (int i = 0; i < m_nBitsInMarker; ++i) {
-                double freq = bitFreq(protocol, i);
-                int bin = round(freq*m_ihzPerSample);
+            RS::ReedSolomon rsLength(1, m_encodedDataOffset - 1, m_rx.workRSLength[workerId].data());
+            const int res = rsLength.Decode(dataEncoded.data(), &length);
+            addRSStats(m_rx.workStats[workerId], rsLength);
 
-                if (i%2 == 0) {
-                    if (m_rx.spectrum[bin] <= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) --nDetectedMarkerBits;
-                } else {
-                    if (m_rx.spectrum[bin] >= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) --nDetectedMarkerBits;
-                }
+            if (res != 0 || length == 0 || length > kMaxLengthVariable) {
+                candidate.state = kCandidateRejected;
+                break;
             }
 
-            if (nDetectedMarkerBits == m_nBitsInMarker) {
-                m_rx.markerFreqStart = protocol.freqStart;
-                isReceiving = true;
+            candidate.decodedLength = length;
+        }
+
+        if (candidate.decodedLength > 0) {
+            const int nTotalBytesExpected = m_encodedDataOffset + candidate.decodedLength + ::getECCBytesForLength(candidate.decodedLength);
+            const int nTotalFramesExpected = 2*m_nMarkerFrames + ((nTotalBytesExpected + protocol.bytesPerTx - 1)/protocol.bytesPerTx)*protocol.framesPerTx;
+
+            // the recording is already longer than the expected duration of the transmission
+            if (nFramesRecorded >= 0 && nFramesRecorded + 1 > nTotalFramesExpected) {
+                candidate.state = kCandidateRejected;
                 break;
             }
-        }
 
-        if (isReceiving) {
-            if (++m_rx.nMarkersSuccess >= 1) {
-            } else {
-                isReceiving = false;
+            if (itx*protocol.bytesPerTx > nTotalBytesExpected + 1) {
+                candidate.state = kCandidateComplete;
+                break;
             }
-        } else {
-            m_rx.nMarkersSuccess = 0;
         }
 
-        if (isReceiving) {
-            ggprintf("Receiving sound data ...\n");
+        ++candidate.itx;
+    }
+}
 
-            m_rx.receiving = true;
-            m_rx.data.zero();
+void GGWave::advanceSteps(int stepIdLast) {
+    auto & sdft = m_rx.stepDFT;
 
-            // max recieve duration
-            m_rx.recvDuration_frames =
-                2*m_nMarkerFrames +
-                maxFramesPerTx(m_rx.protocols, true)*(
-                        (kMaxLengthVariable + ::getECCBytesForLength(kMaxLengthVariable))/minBytesPerTx(m_rx.protocols) + 1
-                        );
+    const int nRecordedFrames = m_rx.amplitudeRecorded.size()/m_samplesPerFrame;
 
-            m_rx.nMarkersSuccess = 0;
-            m_rx.framesToRecord = m_rx.recvDuration_frames;
-            m_rx.framesLeftToRecord = m_rx.recvDuration_frames;
-        }
-    } else {
-        bool isEnded = false;
+    // pushing hop h produces the spectrum of the step that starts at hop h - K + 1
+    while (m_rx.stepHopNext < stepIdLast + kStepsPerFrame) {
+        const int stepId = m_rx.stepHopNext - kStepsPerFrame + 1;
 
-        for (int i = 0; i < m_rx.protocols.size(); ++i) {
-            const auto & protocol = m_rx.protocols[i];
-            if (protocol.enabled == false) {
-                continue;
-            }
+        // the frames after the end of the recording are silent
+        // note : the frames that have already left the ring buffer should never be needed since their steps are cached
+        const int frameId = m_rx.stepHopNext/kStepsPerFrame;
+        const bool isRecorded = frameId < m_rx.nFramesRecorded && frameId >= m_rx.nFramesRecorded - nRecordedFrames;
 
-            int nDetectedMarkerBits = m_nBitsInMarker;
+        const bool isReady = sdft.push(isRecorded ?
+                                       m_rx.amplitudeRecorded.data() + (frameId % nRecordedFrames)*m_samplesPerFrame + (m_rx.stepHopNext % kStepsPerFrame)*sdft.hopSize() :
+                                       nullptr);
+        ++m_rx.stepHopNext;
 
-            for (int i = 0; i < m_nBitsInMarker; ++i) {
-                double freq = bitFreq(protocol, i);
-                int bin = round(freq*m_ihzPerSample);
+        if (isReady) {
+            auto & bank = m_rx.banks[m_rx.bankRecord];
+            const int row = stepId % bank.stepSpectrumId.size();
 
-                if (i%2 == 0) {
-                    if (m_rx.spectrum[bin] >= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) nDetectedMarkerBits--;
-                } else {
-                    if (m_rx.spectrum[bin] <= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) nDetectedMarkerBits--;
-                }
-            }
+            memcpy(bank.stepSpectrumCache[row].data(), sdft.output(), 2*m_rx.stepBinCount*sizeof(float));
+            bank.stepSpectrumId[row] = stepId;
 
-            if (nDetectedMarkerBits == m_nBitsInMarker) {
-                isEnded = true;
-                break;
-            }
+            ++bank.stats.nSteps;
         }
+    }
+}
 
-        if (isEnded) {
-            if (++m_rx.nMarkersSuccess >= 1) {
-            } else {
-                isEnded = false;
-            }
-        } else {
-            m_rx.nMarkersSuccess = 0;
+const float * GGWave::stepSpectrum(int bankId, int stepId) {
+    auto & bank = m_rx.banks[bankId];
+    const int row = stepId % bank.stepSpectrumId.size();
+
+    // the recorded data of a detached bank is gone, but all of its steps have been cached in advance
+    if (bank.stepSpectrumId[row] != stepId && bankId == m_rx.bankRecord) {
+        // the sliding DFT moves only forward - restart it if the step has already been evicted
+        if (stepId < m_rx.stepHopNext - kStepsPerFrame + 1) {
+            m_rx.stepDFT.reset();
+            m_rx.stepHopNext = stepId;
         }
 
-        if (isEnded && m_rx.framesToRecord > 1) {
-            m_rx.recvDuration_frames -= m_rx.framesLeftToRecord - 1;
-            ggprintf("Received end marker. Frames left = %d, recorded = %d\n", m_rx.framesLeftToRecord, m_rx.recvDuration_frames);
-            m_rx.nMarkersSuccess = 0;
-            m_rx.framesLeftToRecord = 1;
+        advanceSteps(stepId);
+    }
+
+    return bank.stepSpectrumCache[row].data();
+}
+
+bool GGWave::isStepRangeCached(int bankId, int stepIdFirst, int stepIdLast) const {
+    const auto & bank = m_rx.banks[bankId];
+    if (stepIdLast - stepIdFirst + 1 > bank.stepSpectrumId.size()) {
+        return false;
+    }
+
+    for (int stepId = stepIdFirst; stepId <= stepIdLast; ++stepId) {
+        if (bank.stepSpectrumId[stepId % bank.stepSpectrumId.size()] != stepId) {
+            return false;
         }
     }
+
+    return true;
 }
 
 //
@@ -1877,150 +3376,204 @@ void GGWave::decode_variable() {
 void GGWave::decode_fixed() {
     m_rx.hasNewSpectrum = true;
 
-    // calculate spectrum
-    FFT(m_rx.amplitude.data(), m_rx.fftOut.data(), m_samplesPerFrame, m_rx.fftWorkI.data(), m_rx.fftWorkF.data());
+    // the full spectrum is computed only if requested with rxTakeSpectrum()
+    m_rx.amplitudeAverage.copy(m_rx.amplitude);
+    m_rx.isSpectrumStale = true;
+
+    const int nBins = m_rx.binsFixed.size();
+    if (nBins == 0) {
+        return;
+    }
+
+    // calculate spectrum, only in the band of the lanes. There is nothing above N/2
+    const int binBegin = m_rx.binsFixed[0];
+    const int binEnd   = GG_MIN(m_rx.binsFixed[nBins - 1] + 1, m_samplesPerFrame/2);
+
+    if (binBegin < binEnd) {
+        fftrBand(m_samplesPerFrame, m_rx.amplitude.data(), m_rx.fftOut.data(), m_rx.fftOut.data() + m_samplesPerFrame, binBegin, binEnd);
+    }
 
     float amax = 0.0f;
-    for (int i = 0; i < m_samplesPerFrame; ++i) {
+    for (int i = binBegin; i < binEnd; ++i) {
         m_rx.spectrum[i] = (m_rx.fftOut[2*i + 0]*m_rx.fftOut[2*i + 0] + m_rx.fftOut[2*i + 1]*m_rx.fftOut[2*i + 1]);
+        amax = GG_MAX(amax, m_rx.spectrum[i]);
     }
-    for (int i = 1; i < m_samplesPerFrame/2; ++i) {
-        m_rx.spectrum[i] += m_rx.spectrum[m_samplesPerFrame - i];
-        if (i >= m_rx.minFreqStart) {
-            amax = GG_MAX(amax, m_rx.spectrum[i]);
-        }
+    for (int i = GG_MAX(binBegin, binEnd); i <= m_rx.binsFixed[nBins - 1]; ++i) {
+        m_rx.spectrum[i] = 0.0f;
     }
 
     // original, floating-point version
-    //m_rx.spectrumHistoryFixed[m_rx.historyIdFixed].copy(m_rx.spectrum);
+    //for (int i = 0; i < m_rx.binsFixed.size(); ++i) {
+    //    m_rx.spectrumFixed[i] = m_rx.spectrum[m_rx.binsFixed[i]];
+    //}
 
     // float -> uint8_t
     amax = 255.0f/(amax == 0.0f ? 1.0f : amax);
-    for (int i = 0; i < m_samplesPerFrame; ++i) {
-        m_rx.spectrumHistoryFixed[m_rx.historyIdFixed][i] = GG_MIN(255.0f, GG_MAX(0.0f, (float) round(m_rx.spectrum[i]*amax)));
+    for (int i = 0; i < m_rx.binsFixed.size(); ++i) {
+        m_rx.spectrumFixed[i] = GG_MIN(255.0f, GG_MAX(0.0f, (float) round(m_rx.spectrum[m_rx.binsFixed[i]]*amax)));
     }
 
     // float -> uint16_t
     //amax = 65535.0f/(amax == 0.0f ? 1.0f : amax);
-    //for (int i = 0; i < m_samplesPerFrame; ++i) {
-    //    m_rx.spectrumHistoryFixed[m_rx.historyIdFixed][i] = GG_MIN(65535.0f, GG_MAX(0.0f, (float) round(m_rx.spectrum[i]*amax)));
+    //for (int i = 0; i < m_rx.binsFixed.size(); ++i) {
+    //    m_rx.spectrumFixed[i] = GG_MIN(65535.0f, GG_MAX(0.0f, (float) round(m_rx.spectrum[m_rx.binsFixed[i]]*amax)));
     //}
 
-    if (++m_rx.historyIdFixed >= (int) m_rx.spectrumHistoryFixed.size()) {
-        m_rx.historyIdFixed = 0;
-    }
+    const int totalLength = m_payloadLength + getECCBytesForLength(m_payloadLength);
+    const int nHistory = m_rx.tonesHistoryFixed.size();
 
-    bool isValid = false;
+    // the new frame replaces the oldest one and each Tx slot moves one frame forward:
+    // slot k loses the frame k*framesPerTx frames after the oldest one and gains the one framesPerTx frames later
     for (int protocolId = 0; protocolId < (int) m_rx.protocols.size(); ++protocolId) {
         const auto & protocol = m_rx.protocols[protocolId];
-        if (protocol.enabled == false) {
+        if (m_rx.laneOffsetFixed[protocolId] < 0) {
             continue;
         }
 
-        const int binStart = protocol.freqStart;
-        const int binDelta = 16;
-        const int binOffset = protocol.extra == 1 ? binDelta : 0;
-
-        if (binStart > m_samplesPerFrame) {
+        if (protocol.enabled == false) {
+            m_rx.nDetectedFixed[protocolId] = -1;
             continue;
         }
 
-        const int totalLength = m_payloadLength + getECCBytesForLength(m_payloadLength);
+        if (m_rx.nDetectedFixed[protocolId] < 0) {
+            resetFixed(protocolId);
+        }
+
+        const int laneOffset = m_rx.laneOffsetFixed[protocolId];
+        const int slotOffset = m_rx.slotOffsetFixed[protocolId];
+
+        const int nLanes   = 2*protocol.bytesPerTx/protocol.extra;
         const int totalTxs = protocol.extra*((totalLength + protocol.bytesPerTx - 1)/protocol.bytesPerTx);
 
-        int historyStartId = m_rx.historyIdFixed - totalTxs*protocol.framesPerTx;
-        if (historyStartId < 0) {
-            historyStartId += m_rx.spectrumHistoryFixed.size();
+        // loudest tone of each lane in the new frame
+        auto tones = m_rx.tonesHistoryFixed[m_rx.historyIdFixed];
+        for (int t = 0; t < nLanes; ++t) {
+            const uint8_t * bins = m_rx.spectrumFixed.data() + m_rx.laneBinFixed[laneOffset + t];
+
+            int tone = 0;
+            auto vmax = bins[0];
+            for (int b = 1; b < 16; ++b) {
+                if (vmax <= bins[b]) {
+                    vmax = bins[b];
+                    tone = b;
+                }
+            }
+
+            tones[laneOffset + t] = tone;
         }
 
-        const int nTones = 2*protocol.bytesPerTx;
-        m_rx.detectedBins.zero();
+        int historyId = m_rx.historyIdFixed - totalTxs*protocol.framesPerTx;
+        if (historyId < 0) {
+            historyId += nHistory;
+        }
 
-        int txNeededTotal   = 0;
-        int txDetectedTotal = 0;
-        bool detectedSignal = true;
+        int & nDetected = m_rx.nDetectedFixed[protocolId];
 
         for (int k = 0; k < totalTxs; ++k) {
-            if (k % protocol.extra == 0) {
-                m_rx.detectedTones.zero(16*nTones);
+            int historyIdNext = historyId + protocol.framesPerTx;
+            if (historyIdNext >= nHistory) {
+                historyIdNext -= nHistory;
             }
 
-            for (int i = 0; i < protocol.framesPerTx; ++i) {
-                int historyId = historyStartId + k*protocol.framesPerTx + i;
-                if (historyId >= (int) m_rx.spectrumHistoryFixed.size()) {
-                    historyId -= m_rx.spectrumHistoryFixed.size();
+            const auto tonesOld = m_rx.tonesHistoryFixed[historyId];
+            const auto tonesNew = m_rx.tonesHistoryFixed[historyIdNext];
+
+            for (int t = 0; t < nLanes; ++t) {
+                const int toneOld = tonesOld[laneOffset + t];
+                const int toneNew = tonesNew[laneOffset + t];
+                if (toneOld == toneNew) {
+                    continue;
                 }
 
-                for (int j = 0; j < protocol.bytesPerTx; ++j) {
-                    int f0bin = 0;
-                    auto f0max = m_rx.spectrumHistoryFixed[historyId][binStart + 2*j*binDelta];
+                const int slot = slotOffset + k*nLanes + t;
+                auto votes = m_rx.votesFixed[slot];
 
-                    for (int b = 1; b < 16; ++b) {
-                        {
-                            const auto & v = m_rx.spectrumHistoryFixed[historyId][binStart + 2*j*binDelta + b];
+                const bool isNeeded = (k/protocol.extra)*protocol.bytesPerTx + (protocol.extra == 1 ? t/2 : t) < totalLength;
 
-                            if (f0max <= v) {
-                                f0max = v;
-                                f0bin = b;
-                            }
-                        }
+                if (votes[toneOld]-- > protocol.framesPerTx/2 && votes[toneOld] <= protocol.framesPerTx/2) {
+                    m_rx.majorityFixed[slot] = -1;
+                    if (isNeeded) {
+                        --nDetected;
+                        m_rx.isChangedFixed[protocolId] = 1;
                     }
-
-                    int f1bin = 0;
-                    if (protocol.extra == 1) {
-                        auto f1max = m_rx.spectrumHistoryFixed[historyId][binStart + 2*j*binDelta + binOffset];
-                        for (int b = 1; b < 16; ++b) {
-                            const auto & v = m_rx.spectrumHistoryFixed[historyId][binStart + 2*j*binDelta + binOffset + b];
-
-                            if (f1max <= v) {
-                                f1max = v;
-                                f1bin = b;
-                            }
-                        }
-                    } else {
-                        f1bin = f0bin;
+                }
+                if (votes[toneNew]++ <= protocol.framesPerTx/2 && votes[toneNew] > protocol.framesPerTx/2) {
+                    m_rx.majorityFixed[slot] = toneNew;
+                    if (isNeeded) {
+                        ++nDetected;
+                        m_rx.isChangedFixed[protocolId] = 1;
                     }
+                }
 
-                    if ((k + 0)%protocol.extra == 0) m_rx.detectedTones[(2*j + 0)*16 + f0bin]++;
-                    if ((k + 1)%protocol.extra == 0) m_rx.detectedTones[(2*j + 1)*16 + f1bin]++;
+                // the votes of the majority tone are the confidence of the slot, which selects the erasures
+                const int majority = m_rx.majorityFixed[slot];
+                if (isNeeded && majority >= 0 && (majority == toneOld || majority == toneNew)) {
+                    m_rx.isChangedFixed[protocolId] = 1;
                 }
             }
 
-            if (protocol.extra > 1 && (k % protocol.extra == 0)) continue;
+            historyId = historyIdNext;
+        }
+    }
 
-            int txNeeded = 0;
-            int txDetected = 0;
-            for (int j = 0; j < protocol.bytesPerTx; ++j) {
-                if ((k/protocol.extra)*protocol.bytesPerTx + j >= totalLength) break;
-                txNeeded += 2;
-                for (int b = 0; b < 16; ++b) {
-                    if (m_rx.detectedTones[(2*j + 0)*16 + b] > protocol.framesPerTx/2) {
-                        m_rx.detectedBins[2*((k/protocol.extra)*protocol.bytesPerTx + j) + 0] = b;
-                        txDetected++;
-                    }
-                    if (m_rx.detectedTones[(2*j + 1)*16 + b] > protocol.framesPerTx/2) {
-                        m_rx.detectedBins[2*((k/protocol.extra)*protocol.bytesPerTx + j) + 1] = b;
-                        txDetected++;
-                    }
-                }
-            }
+    if (++m_rx.historyIdFixed >= nHistory) {
+        m_rx.historyIdFixed = 0;
+    }
+
+    bool isValid = false;
+    for (int protocolId = 0; protocolId < (int) m_rx.protocols.size(); ++protocolId) {
+        const auto & protocol = m_rx.protocols[protocolId];
+        if (protocol.enabled == false || m_rx.nDetectedFixed[protocolId] < 0) {
+            continue;
+        }
 
-            txDetectedTotal += txDetected;
-            txNeededTotal += txNeeded;
+        bool detectedSignal = true;
+
+        if (m_rx.nDetectedFixed[protocolId] < 0.75*2*totalLength) {
+            detectedSignal = false;
         }
 
-        if (txDetectedTotal < 0.75*txNeededTotal) {
+        // the same tones with the same confidence have already failed to decode
+        if (m_rx.isChangedFixed[protocolId] == 0) {
             detectedSignal = false;
         }
 
         if (detectedSignal) {
             RS::ReedSolomon rsData(m_payloadLength, getECCBytesForLength(m_payloadLength), m_workRSData.data());
 
+            const int slotOffset = m_rx.slotOffsetFixed[protocolId];
+            const int nLanes = 2*protocol.bytesPerTx/protocol.extra;
+
+            // the two 4-bit halves of each byte - the tones that have not been detected are 0
             for (int j = 0; j < totalLength; ++j) {
-                m_dataEncoded[j] = (m_rx.detectedBins[2*j + 1] << 4) + m_rx.detectedBins[2*j + 0];
+                const int k = j/protocol.bytesPerTx;
+                const int i = j%protocol.bytesPerTx;
+
+                int slot0 = 0;
+                int slot1 = 0;
+                if (protocol.extra == 1) {
+                    slot0 = slotOffset + k*nLanes + 2*i + 0;
+                    slot1 = slotOffset + k*nLanes + 2*i + 1;
+                } else {
+                    slot0 = slotOffset + (protocol.extra*k + 0)*nLanes + i;
+                    slot1 = slotOffset + (protocol.extra*k + 1)*nLanes + i;
+                }
+
+                const int tone0 = GG_MAX(0, (int) m_rx.majorityFixed[slot0]);
+                const int tone1 = GG_MAX(0, (int) m_rx.majorityFixed[slot1]);
+
+                m_dataEncoded[j] = (tone1 << 4) + tone0;
+
+                // the number of frames that voted for the detected tones
+                const int votes0 = m_rx.majorityFixed[slot0] < 0 ? 0 : m_rx.votesFixed[slot0][tone0];
+                const int votes1 = m_rx.majorityFixed[slot1] < 0 ? 0 : m_rx.votesFixed[slot1][tone1];
+
+                m_rx.confidenceFixed[j] = GG_MIN(votes0, votes1);
             }
 
-            if (rsData.Decode(m_dataEncoded.data(), m_rx.data.data()) == 0) {
+            const int res = ::decodeRS(rsData, m_dataEncoded.data(), m_rx.confidenceFixed.data(), m_rx.erasuresFixed.data(), m_rx.data.data(), m_rx.stats);
+
+            if (res == 0) {
                 if (m_isDSSEnabled) {
                     for (int i = 0; i < m_payloadLength; ++i) {
                         m_rx.data[i] = m_rx.data[i] ^ getDSSMagic(i);
@@ -2035,6 +3588,8 @@ void GGWave::decode_fixed() {
                 m_rx.dataLength = m_payloadLength;
                 m_rx.protocol = protocol;
                 m_rx.protocolId = RxProtocolId(protocolId);
+            } else {
+                m_rx.isChangedFixed[protocolId] = 0;
             }
         }
 
@@ -2044,6 +3599,45 @@ void GGWave::decode_fixed() {
     }
 }
 
+void GGWave::resetFixed(int protocolId) {
+    const auto & protocol = m_rx.protocols[protocolId];
+
+    const int totalLength = m_payloadLength + getECCBytesForLength(m_payloadLength);
+
+    const int laneOffset = m_rx.laneOffsetFixed[protocolId];
+    const int slotOffset = m_rx.slotOffsetFixed[protocolId];
+
+    const int nLanes   = 2*protocol.bytesPerTx/protocol.extra;
+    const int totalTxs = protocol.extra*((totalLength + protocol.bytesPerTx - 1)/protocol.bytesPerTx);
+
+    // same as a history of silent frames - the last bin of each lane is the loudest one
+    for (int i = 0; i < m_rx.tonesHistoryFixed.size(); ++i) {
+        auto tones = m_rx.tonesHistoryFixed[i];
+        for (int t = 0; t < nLanes; ++t) {
+            tones[laneOffset + t] = 15;
+        }
+    }
+
+    m_rx.nDetectedFixed[protocolId] = 0;
+    m_rx.isChangedFixed[protocolId] = 1;
+
+    for (int k = 0; k < totalTxs; ++k) {
+        for (int t = 0; t < nLanes; ++t) {
+            const int slot = slotOffset + k*nLanes + t;
+
+            auto votes = m_rx.votesFixed[slot];
+            votes.zero();
+            votes[15] = protocol.framesPerTx;
+
+            m_rx.majorityFixed[slot] = 15;
+
+            if ((k/protocol.extra)*protocol.bytesPerTx + (protocol.extra == 1 ? t/2 : t) < totalLength) {
+                ++m_rx.nDetectedFixed[protocolId];
+            }
+        }
+    }
+}
+
 int GGWave::maxFramesPerTx(const Protocols & protocols, bool excludeMT) const {
     int res = 0;
     for (int i = 0; i < protocols.size(); ++i) {
@@ -2095,6 +3689,14 @@ int GGWave::maxTonesPerTx(const Protocols & protocols) const {
     return res;
 }
 
+const uint8_t * GGWave::rsGenerator(int eccLength) const {
+    if (eccLength >= m_rsGeneratorOffset.size() || m_rsGeneratorOffset[eccLength] < 0) {
+        return nullptr;
+    }
+
+    return m_rsGenerators.data() + m_rsGeneratorOffset[eccLength];
+}
+
 int GGWave::minFreqStart(const Protocols & protocols) const {
     int res = m_samplesPerFrame;
     for (int i = 0; i < protocols.size(); ++i) {
@@ -2107,6 +3709,62 @@ int GGWave::minFreqStart(const Protocols & protocols) const {
     return res;
 }
 
+int GGWave::txTemplateSets(const Protocols & protocols, int * freqStart, int * dataBits) const {
+    int res = 0;
+    for (int i = 0; i < protocols.size(); ++i) {
+        const auto & protocol = protocols[i];
+        if (protocol.enabled == false) {
+            continue;
+        }
+        bool found = false;
+        for (int j = 0; j < res; ++j) {
+            if (freqStart[j] == protocol.freqStart && dataBits[j] == protocol.nDataBitsPerTx()) {
+                found = true;
+                break;
+            }
+        }
+        if (found == false) {
+            freqStart[res] = protocol.freqStart;
+            dataBits[res]  = protocol.nDataBitsPerTx();
+            ++res;
+        }
+    }
+    return res;
+}
+
+int GGWave::txTemplateSet(int freqStart, int dataBits) const {
+    for (int i = 0; i < m_tx.nTemplateSets; ++i) {
+        if (m_tx.templatesFreqStart[i] == freqStart && m_tx.templatesDataBits[i] == dataBits) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int GGWave::txTemplateRows(int dataBits) const {
+    // the marker tones use the first m_nBitsInMarker rows, the data tones the first 2*dataBits rows
+    return GG_MAX(m_nBitsInMarker, 2*dataBits);
+}
+
+int GGWave::maxProtocolsPerFreqStart(const Protocols & protocols) const {
+    int res = 1;
+    for (int i = 0; i < protocols.size(); ++i) {
+        const auto & protocol = protocols[i];
+        if (protocol.enabled == false || protocol.extra == 2) {
+            continue;
+        }
+        int n = 0;
+        for (int j = 0; j < protocols.size(); ++j) {
+            const auto & other = protocols[j];
+            if (other.enabled && other.extra != 2 && other.freqStart == protocol.freqStart) {
+                ++n;
+            }
+        }
+        res = GG_MAX(res, n);
+    }
+    return res;
+}
+
 double GGWave::bitFreq(const Protocol & p, int bit) const {
     return m_hzPerSample*p.freqStart + m_freqDelta_hz*bit;
 }
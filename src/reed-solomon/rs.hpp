@@ -19,22 +19,64 @@ namespace RS {
 #define MSG_CNT 3   // message-length polynomials count
 #define POLY_CNT 14 // (ecc_length*2)-length polynomialc count
 
+// gg : the encoder uses 32*ecc_length bytes of multiplication tables, except on microcontrollers
+#if !defined(ARDUINO) && !defined(RS_NO_ENCODE_TABLES)
+#define RS_ENCODE_TABLES
+#endif
+
 class ReedSolomon {
 public:
     const uint8_t msg_length;
     const uint8_t ecc_length;
 
     uint8_t * heap_memory = nullptr;
-    uint8_t * generator_cache = nullptr;
+    const uint8_t * generator_cache = nullptr;
+    const uint8_t * encode_tables = nullptr;
     bool owns_heap_memory = false;
     bool generator_cached = false;
 
+    // gg : the last stage reached by DecodeBlock()
+    enum DECODE_STAGE {
+        STAGE_NONE = 0,   // rejected before computing the syndromes - too many erasures
+        STAGE_SYNDROMES,  // the syndromes are computed. If they are all zero, there are no errors
+        STAGE_LOCATOR,    // the error locator is computed
+        STAGE_CHIEN,      // the number of errors is within the correction capacity and their positions are searched
+        STAGE_CORRECTED,  // the errors are corrected
+    };
+
+    uint8_t decode_stage = STAGE_NONE;
+
+    // gg : number of errors found by the last DecodeBlock() call, not counting the erasures
+    uint8_t error_count = 0;
+
+    // gg : the decoding is rejected unless erasures + 2*errors leaves at least this many ECC bytes unused. Each unused
+    //      ECC byte makes it about 256 times less likely to accept a wrong correction
+    uint8_t ecc_reserved = 0;
+
+    // gg : size of the tables for multiplying the generator polynomial by a byte, one nibble at a time
+    static size_t getEncodeTablesSize_bytes(uint8_t ecc_length) {
+#ifdef RS_ENCODE_TABLES
+        return 32 * ecc_length;
+#else
+        (void) ecc_length;
+        return 0;
+#endif
+    }
+
+    // gg : size of the generator polynomial followed by its encoding tables
+    static size_t getGeneratorSize_bytes(uint8_t ecc_length) {
+        return ecc_length + 1 + getEncodeTablesSize_bytes(ecc_length);
+    }
+
     // used to pre-allocate a memory buffer for the Reed-Solomon class in order to avoid memory allocations
     static size_t getWorkSize_bytes(uint8_t msg_length, uint8_t ecc_length) {
-        return ecc_length + 1 + MSG_CNT * msg_length + POLY_CNT * ecc_length * 2;
+        return getGeneratorSize_bytes(ecc_length) + MSG_CNT * msg_length + POLY_CNT * (ecc_length * 2 + 1);
     }
 
-    ReedSolomon(uint8_t msg_length_p, uint8_t ecc_length_p, uint8_t * heap_memory_p = nullptr) :
+    // gg : generator_p - optional generator polynomial computed with GeneratorPoly(), which can be shared by
+    //                    multiple instances with the same ecc_length. Otherwise, it is computed in the work buffer
+    //                    by the first EncodeBlock() call
+    ReedSolomon(uint8_t msg_length_p, uint8_t ecc_length_p, uint8_t * heap_memory_p = nullptr, const uint8_t * generator_p = nullptr) :
         msg_length(msg_length_p), ecc_length(ecc_length_p) {
         if (heap_memory_p) {
             heap_memory = heap_memory_p;
@@ -43,10 +85,18 @@ public:
             heap_memory = (uint8_t *) malloc(getWorkSize_bytes(msg_length, ecc_length));
             owns_heap_memory = true;
         }
-        generator_cache = heap_memory;
+        if (generator_p) {
+            generator_cache = generator_p;
+            generator_cached = true;
+        } else {
+            generator_cache = heap_memory;
+        }
+        encode_tables = generator_cache + ecc_length + 1;
 
         const uint8_t   enc_len  = msg_length + ecc_length;
-        const uint8_t   poly_len = ecc_length * 2;
+        // gg : the error evaluator is the product of the syndromes and the errata locator, each with up to
+        //      ecc_length + 1 coefficients
+        const uint8_t   poly_len = ecc_length * 2 + 1;
         uint8_t** memptr   = &memory;
         uint16_t  offset   = 0;
 
@@ -80,6 +130,25 @@ public:
         memory = NULL;
     }
 
+    /* gg : computes the generator polynomial for ecc_length and its encoding tables
+     * @param ecc_length - number of ECC bytes
+     * @param *dst       - output buffer         (getGeneratorSize_bytes(ecc_length) size) */
+    static void GeneratorPoly(uint8_t ecc_length, uint8_t* dst) {
+        /* multiplying by (x + 2^i) in place, from the highest coefficient */
+        memset(dst, 0, ecc_length + 1);
+        dst[0] = 1;
+        for(int i = 0; i < ecc_length; i++){
+            const uint8_t root = gf::pow(2, i);
+            for(int j = i + 1; j > 0; j--){
+                dst[j] ^= gf::mul(dst[j - 1], root);
+            }
+        }
+
+#ifdef RS_ENCODE_TABLES
+        EncodeTables(dst, ecc_length, dst + ecc_length + 1);
+#endif
+    }
+
     /* @brief Message block encoding
      * @param *src - input message buffer      (msg_lenth size)
      * @param *dst - output buffer for ecc     (ecc_length size at least) */
@@ -91,7 +160,7 @@ public:
         //this->memory = stack_memory;
 
         // gg : allocation is now on the heap
-        this->memory = heap_memory + ecc_length + 1;
+        this->memory = heap_memory + getGeneratorSize_bytes(ecc_length);
 
         const uint8_t* src_ptr = (const uint8_t*) src;
         uint8_t* dst_ptr = (uint8_t*) dst;
@@ -105,13 +174,11 @@ public:
         msg_out->Reset();
 
         // Using cached generator or generating new one
-        if(generator_cached) {
-            gen->Set(generator_cache, ecc_length + 1);
-        } else {
-            GeneratorPoly();
-            memcpy(generator_cache, gen->ptr(), gen->length);
+        if(!generator_cached) {
+            GeneratorPoly(ecc_length, heap_memory);
             generator_cached = true;
         }
+        gen->Set(generator_cache, ecc_length + 1);
 
         // Copying input message to internal polynomial
         msg_in->Set(src_ptr, msg_length);
@@ -119,6 +186,29 @@ public:
         msg_out->length = msg_in->length + ecc_length;
 
         // Here all the magic happens
+#ifdef RS_ENCODE_TABLES
+        // gg : the generator multiplied by coef is the XOR of the rows for its low and high nibbles
+        uint8_t* out = msg_out->ptr();
+        for(uint8_t i = 0; i < msg_length; i++){
+            const uint8_t coef = out[i];
+            const uint8_t* lo = encode_tables + (coef & 0xf) * ecc_length;
+            const uint8_t* hi = encode_tables + (16 + (coef >> 4)) * ecc_length;
+
+            uint8_t* dst = out + i + 1;
+            int j = 0;
+            for(; j + 8 <= ecc_length; j += 8){
+                uint64_t d, l, h;
+                memcpy(&d, dst + j, 8);
+                memcpy(&l, lo + j, 8);
+                memcpy(&h, hi + j, 8);
+                d ^= l ^ h;
+                memcpy(dst + j, &d, 8);
+            }
+            for(; j < ecc_length; j++){
+                dst[j] ^= lo[j] ^ hi[j];
+            }
+        }
+#else
         uint8_t coef = 0; // cache
         for(uint8_t i = 0; i < msg_length; i++){
             coef = msg_out->at(i);
@@ -128,6 +218,7 @@ public:
                 }
             }
         }
+#endif
 
         // Copying ECC to the output buffer
         memcpy(dst_ptr, msg_out->ptr()+msg_length, ecc_length * sizeof(uint8_t));
@@ -165,12 +256,15 @@ public:
 
         bool ok;
 
+        decode_stage = STAGE_NONE;
+        error_count  = 0;
+
         ///* Allocation memory on stack  */
         //uint8_t stack_memory[MSG_CNT * msg_length + POLY_CNT * ecc_length * 2];
         //this->memory = stack_memory;
 
         // gg : allocation is now on the heap
-        this->memory = heap_memory + ecc_length + 1;
+        this->memory = heap_memory + getGeneratorSize_bytes(ecc_length);
 
         Poly *msg_in  = &polynoms[ID_MSG_IN];
         Poly *msg_out = &polynoms[ID_MSG_OUT];
@@ -179,7 +273,6 @@ public:
         // Copying message to polynomials memory
         msg_in->Set(src_ptr, msg_length);
         msg_in->Set(ecc_ptr, ecc_length, msg_length);
-        msg_out->Copy(msg_in);
 
         // Copying known errors to polynomial
         if(erase_pos == NULL) {
@@ -191,8 +284,11 @@ public:
             }
         }
 
+        // gg : copied after zeroing the erasures - if the syndromes are zero, the codeword is the one with zeros
+        msg_out->Copy(msg_in);
+
         // Too many errors
-        if(epos->length > ecc_length) return 1;
+        if(epos->length + ecc_reserved > ecc_length) return 1;
 
         Poly *synd   = &polynoms[ID_SYNDROMES];
         Poly *eloc   = &polynoms[ID_ERRORS_LOC];
@@ -202,6 +298,7 @@ public:
 
         // Calculating syndrome
         CalcSyndromes(msg_in);
+        decode_stage = STAGE_SYNDROMES;
 
         // Checking for errors
         bool has_errors = false;
@@ -216,7 +313,11 @@ public:
         if(!has_errors) goto return_corrected_msg;
 
         CalcForneySyndromes(synd, epos, src_len);
-        FindErrorLocator(forney, NULL, epos->length);
+        decode_stage = STAGE_LOCATOR;
+
+        // gg : more errors than the ECC bytes can correct - no need to search for them
+        if(!FindErrorLocator(forney, NULL, epos->length)) return 1;
+        decode_stage = STAGE_CHIEN;
 
         // Reversing syndrome
         // TODO optimize through special Poly flag
@@ -230,15 +331,31 @@ public:
         if(!ok) return 1;
 
         // Error happened while finding errors (so helpfull :D)
-        if(err->length == 0) return 1;
+        // gg : with erasures, there might be no other errors
+        if(err->length == 0 && epos->length == 0) return 1;
+
+        if(epos->length + 2 * err->length + ecc_reserved > ecc_length) return 1;
 
         /* Adding found errors with known */
         for(uint8_t i = 0; i < err->length; i++) {
+            // gg : an error at an erased position means that the locator is wrong
+            for(uint8_t j = 0; j < erase_count; j++) {
+                if(epos->at(j) == err->at(i)) return 1;
+            }
             epos->Append(err->at(i));
         }
 
         // Correcting errors
-        CorrectErrata(synd, epos, msg_in);
+        if(!CorrectErrata(synd, epos, msg_in)) return 1;
+
+        // gg : a wrong correction is not a codeword
+        CalcSyndromes(msg_out);
+        for(uint8_t i = 0; i < synd->length; i++) {
+            if(synd->at(i) != 0) return 1;
+        }
+
+        error_count = err->length;
+        decode_stage = STAGE_CORRECTED;
 
     return_corrected_msg:
         // Wrighting corrected message to output buffer
@@ -293,31 +410,62 @@ private:
     uint8_t* memory;
     Poly polynoms[MSG_CNT + POLY_CNT];
 
-    void GeneratorPoly() {
-        Poly *gen = polynoms + ID_GENERATOR;
-        gen->at(0) = 1;
-        gen->length = 1;
-
-        Poly *mulp = polynoms + ID_TPOLY1;
-        Poly *temp = polynoms + ID_TPOLY2;
-        mulp->length = 2;
-
-        for(int8_t i = 0; i < ecc_length; i++){
-            mulp->at(0) = 1;
-            mulp->at(1) = gf::pow(2, i);
-
-            gf::poly_mul(gen, mulp, temp);
+    /* gg : rows n and 16 + n of the tables are the coefficients 1..ecc_length of the generator multiplied by n
+     * and by n << 4. The rows for the powers of 2 are obtained by doubling and the rest by XOR-ing them */
+    static void EncodeTables(const uint8_t *gen, uint8_t ecc_length, uint8_t *tables) {
+        uint8_t* lo = tables;
+        uint8_t* hi = tables + 16 * ecc_length;
+
+        memset(lo, 0, ecc_length);
+        memset(hi, 0, ecc_length);
+        memcpy(lo + ecc_length, gen + 1, ecc_length);
+
+        for(int v = 2; v < 256; v *= 2){
+            const uint8_t* prev = v/2 < 16 ? lo + (v/2) * ecc_length : hi + (v/32) * ecc_length;
+            uint8_t* row = v < 16 ? lo + v * ecc_length : hi + (v/16) * ecc_length;
+            for(int j = 0; j < ecc_length; j++){
+                row[j] = (prev[j] << 1) ^ ((prev[j] & 0x80) ? 0x1d : 0);
+            }
+        }
 
-            gen->Copy(temp);
+        for(int n = 3; n < 16; n++){
+            const int b = n & (n - 1);
+            if(b == 0) continue;
+            for(int j = 0; j < ecc_length; j++){
+                lo[n * ecc_length + j] = lo[b * ecc_length + j] ^ lo[(n - b) * ecc_length + j];
+                hi[n * ecc_length + j] = hi[b * ecc_length + j] ^ hi[(n - b) * ecc_length + j];
+            }
         }
     }
 
+    /* gg : synd[i + 1] = msg(2^i) is the sum of msg[k] * 2^(i*p) for the position p = msg->length - 1 - k. Each
+     * non-zero byte adds exp[log(msg[k]) + i*p] to all syndromes, so there are no log lookups and no zero checks
+     * in the inner loop */
     void CalcSyndromes(const Poly *msg) {
         Poly *synd = &polynoms[ID_SYNDROMES];
         synd->length = ecc_length+1;
-        synd->at(0) = 0;
-        for(uint8_t i = 1; i < ecc_length+1; i++){
-            synd->at(i) = gf::poly_eval(msg, gf::pow(2, i-1));
+        memset(synd->ptr(), 0, synd->length);
+
+        uint8_t* s = synd->ptr() + 1;
+        for(int k = 0; k < msg->length; k++){
+            const uint8_t c = msg->at(k);
+            if(c == 0) continue;
+
+            const int p = (msg->length - 1 - k) % 255;
+#ifdef ARDUINO
+            int e = pgm_read_byte(gf::log + c);
+#else
+            int e = gf::log[c];
+#endif
+            for(int i = 0; i < ecc_length; i++){
+#ifdef ARDUINO
+                s[i] ^= pgm_read_byte(gf::exp + e);
+#else
+                s[i] ^= gf::exp[e];
+#endif
+                e += p;
+                e -= e >= 255 ? 255 : 0;
+            }
         }
     }
 
@@ -359,7 +507,8 @@ private:
         gf::poly_div(mulp, divisor, dst);
     }
 
-    void CorrectErrata(const Poly *synd, const Poly *err_pos, const Poly *msg_in) {
+    // gg : returns false if the errata positions are not distinct
+    bool CorrectErrata(const Poly *synd, const Poly *err_pos, const Poly *msg_in) {
         Poly *c_pos     = &polynoms[ID_COEF_POS];
         Poly *corrected = &polynoms[ID_MSG_OUT];
         c_pos->length = err_pos->length;
@@ -429,6 +578,8 @@ private:
                 err_loc_prime = gf::mul(err_loc_prime, err_loc_prime_temp->at(j));
             }
 
+            if(err_loc_prime == 0) return false;
+
             y = gf::poly_eval(re_eval, Xi_inv);
             y = gf::mul(gf::pow(X->at(i), 1), y);
 
@@ -436,6 +587,7 @@ private:
         }
 
         gf::poly_add(msg_in, E, corrected);
+        return true;
     }
 
     bool FindErrorLocator(const Poly *synd, Poly *erase_loc = NULL, size_t erase_count = 0) {
@@ -493,8 +645,9 @@ private:
         uint32_t shift = 0;
         while(err_loc->length && err_loc->at(shift) == 0) shift++;
 
-        uint32_t errs = err_loc->length - shift - 1;
-        if(((errs - erase_count) * 2 + erase_count) > ecc_length){
+        // gg : the Forney syndromes exclude the erasures, so errs counts only the errors
+        const int errs = err_loc->length - shift - 1;
+        if(2 * errs + (int) erase_count > ecc_length){
             return false; /* Error count is greater then we can fix! */
         }
 
@@ -0,0 +1,69 @@
+#include "ggwave/ggwave.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+//
+// Measure the cost of computing the FFTs of many frames
+//
+// The frames overlap by 3/4, like the frames of a spectrogram. For each frame size, the FFTs are computed one
+// frame at a time with computeFFTR() and all at once with computeFFTRBatch(). Reports the time per frame of the
+// fastest iteration.
+//
+
+int main(int argc, char ** argv) {
+    const int nFrames     = argc > 1 ? atoi(argv[1]) : 256;
+    const int nIterations = argc > 2 ? atoi(argv[2]) : 20;
+
+    if (nFrames <= 0 || nIterations <= 0) {
+        fprintf(stderr, "Invalid number of frames or iterations: %d %d\n", nFrames, nIterations);
+        return 1;
+    }
+
+    GGWave::setLogFile(nullptr);
+
+    printf("frames: %d, iterations: %d\n\n", nFrames, nIterations);
+    printf("%8s %16s %16s %10s\n", "N", "single [us]", "batch [us]", "speedup");
+
+    for (int N = 256; N <= GGWave::kMaxSamplesPerFrame; N *= 2) {
+        const int stride = N/4;
+
+        std::vector<float> src((nFrames - 1)*stride + N);
+        for (auto & x : src) {
+            x = float(rand())/RAND_MAX - 0.5f;
+        }
+
+        std::vector<float> dst(2*N*nFrames);
+
+        int   wi = 0;
+        float wf = 0.0f;
+
+        double tSingle_us = 1e9;
+        double tBatch_us  = 1e9;
+
+        for (int iter = 0; iter < nIterations; ++iter) {
+            {
+                const auto tStart = std::chrono::high_resolution_clock::now();
+                for (int i = 0; i < nFrames; ++i) {
+                    GGWave::computeFFTR(src.data() + i*stride, dst.data() + 2*i*N, N, &wi, &wf);
+                }
+                const auto tEnd = std::chrono::high_resolution_clock::now();
+                tSingle_us = std::min(tSingle_us, std::chrono::duration<double, std::micro>(tEnd - tStart).count()/nFrames);
+            }
+
+            {
+                const auto tStart = std::chrono::high_resolution_clock::now();
+                GGWave::computeFFTRBatch(src.data(), dst.data(), N, nFrames, stride);
+                const auto tEnd = std::chrono::high_resolution_clock::now();
+                tBatch_us = std::min(tBatch_us, std::chrono::duration<double, std::micro>(tEnd - tStart).count()/nFrames);
+            }
+        }
+
+        printf("%8d %16.3f %16.3f %9.2fx\n", N, tSingle_us, tBatch_us, tSingle_us/tBatch_us);
+    }
+
+    return 0;
+}
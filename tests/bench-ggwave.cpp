@@ -0,0 +1,122 @@
+#include "ggwave/ggwave.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+//
+// Measure the cost of decoding variable-length payloads
+//
+// For each protocol, a message is encoded and then decoded frame by frame, like it would be
+// when capturing audio in real-time. Reports the number of FFTs computed while analyzing the
+// recorded data, the total decoding time and the longest single decode() call.
+// The analysis uses full FFTs ("FFTs") and sliding DFT steps restricted to the data bins ("steps").
+//
+// If the number of threads is > 1, the decoding tasks are run on separate threads.
+//
+
+int main(int argc, char ** argv) {
+    const int payloadLength = argc > 1 ? atoi(argv[1]) : GGWave::kMaxLengthVariable;
+    const int nIterations   = argc > 2 ? atoi(argv[2]) : 5;
+    const int nThreads      = argc > 3 ? atoi(argv[3]) : 1;
+
+    if (payloadLength <= 0 || payloadLength > GGWave::kMaxLengthVariable) {
+        fprintf(stderr, "Invalid payload length: %d\n", payloadLength);
+        return 1;
+    }
+
+    GGWave::setLogFile(nullptr);
+
+    auto parameters = GGWave::getDefaultParameters();
+    parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_F32;
+    parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_F32;
+
+    GGWave::Executor executor;
+    if (nThreads > 1) {
+        executor.nWorkers = nThreads;
+        executor.run = [](void * , GGWave::Executor::Task task, void * taskData, int nTasks) {
+            std::vector<std::thread> workers;
+            for (int i = 1; i < nTasks; ++i) {
+                workers.emplace_back(task, taskData, i);
+            }
+            task(taskData, 0);
+            for (auto & worker : workers) {
+                worker.join();
+            }
+        };
+    }
+
+    GGWave instance;
+    instance.prepare(parameters, executor);
+
+    std::string payload(payloadLength, ' ');
+    for (int i = 0; i < payloadLength; ++i) {
+        payload[i] = 'a' + i%26;
+    }
+
+    const int frameSize = instance.samplesPerFrame()*instance.sampleSizeInp();
+
+    printf("payload length: %d bytes, iterations: %d, threads: %d\n\n", payloadLength, nIterations, nThreads);
+    printf("%-16s %8s %8s %8s %8s %8s %8s %12s %12s\n", "protocol", "decoded", "FFTs", "steps", "RS", "RS loc", "RS Chien", "total [ms]", "max [ms]");
+
+    for (int protocolId = 0; protocolId < GGWAVE_PROTOCOL_COUNT; ++protocolId) {
+        const auto & protocol = instance.txProtocols()[protocolId];
+        if (protocol.enabled == false || protocol.extra == 2) {
+            continue;
+        }
+
+        if (instance.init(payload.size(), payload.data(), GGWave::TxProtocolId(protocolId), 25) == false) {
+            continue;
+        }
+
+        const int nBytes = instance.encode();
+
+        // surround the transmission with silence
+        std::vector<char> waveform(4*frameSize, 0);
+        waveform.insert(waveform.end(), (const char *) instance.txWaveform(), (const char *) instance.txWaveform() + nBytes);
+        waveform.resize(waveform.size() + 64*frameSize, 0);
+
+        int nDecoded = 0;
+        int nFFT = 0;
+        int nSteps = 0;
+        int nRSDecodes = 0;
+        int nRSLocator = 0;
+        int nRSChien = 0;
+        double tTotal_ms = 0.0;
+        double tMax_ms = 0.0;
+
+        for (int iter = 0; iter < nIterations; ++iter) {
+            for (int offset = 0; offset + frameSize <= (int) waveform.size(); offset += frameSize) {
+                const auto tStart = std::chrono::high_resolution_clock::now();
+                instance.decode(waveform.data() + offset, frameSize);
+                const auto tEnd = std::chrono::high_resolution_clock::now();
+
+                const double t_ms = std::chrono::duration<double, std::milli>(tEnd - tStart).count();
+                tTotal_ms += t_ms;
+                tMax_ms = t_ms > tMax_ms ? t_ms : tMax_ms;
+
+                GGWave::TxRxData data;
+                const int n = instance.rxTakeData(data);
+                if (n == payloadLength && memcmp(data.data(), payload.data(), n) == 0) {
+                    ++nDecoded;
+                    nFFT += instance.rxStats().nFFT;
+                    nSteps += instance.rxStats().nSteps;
+                    nRSDecodes += instance.rxStats().nRSDecodes;
+                    nRSLocator += instance.rxStats().nRSLocator;
+                    nRSChien += instance.rxStats().nRSChien;
+                }
+            }
+        }
+
+        const int n = nDecoded > 0 ? nDecoded : 1;
+        printf("%-16s %5d/%-2d %8d %8d %8d %8d %8d %12.3f %12.3f\n",
+               protocol.name, nDecoded, nIterations,
+               nFFT/n, nSteps/n, nRSDecodes/n, nRSLocator/n, nRSChien/n, tTotal_ms/nIterations, tMax_ms);
+    }
+
+    return 0;
+}
@@ -34,6 +34,46 @@ int main() {
     int ne = ggwave_encode(instance, payload, 4, GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 50, waveform, 0);
     CHECK(ne > 0);
 
+    // single-pass encode into the caller buffer
+    {
+        CHECK(ggwave_nencode(instance, payload, 4, GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 50, NULL, 0) == ne);
+
+        char *waveformTmp = malloc(ne);
+        CHECK(waveformTmp != NULL);
+
+        ret = ggwave_nencode(instance, payload, 4, GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 50, waveformTmp, ne - 1);
+        CHECK(ret == -2); // fail
+
+        ret = ggwave_nencode(instance, payload, 4, GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 50, waveformTmp, ne);
+        CHECK(ret == ne); // success
+        CHECK(memcmp(waveformTmp, waveform, ne) == 0);
+
+        free(waveformTmp);
+
+        // empty payload
+        CHECK(ggwave_encode(instance, payload, 0, GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 50, waveform, 0) == -1);
+        CHECK(ggwave_nencode(instance, payload, 0, GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 50, NULL, 0) == -1);
+        CHECK(ggwave_nencode(instance, payload, 0, GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 50, waveform, ne) == -1);
+        CHECK(ggwave_txBegin(instance, payload, 0, GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 50) == -1);
+    }
+
+    // encode once and render in parts
+    {
+        CHECK(ggwave_txBegin(instance, payload, 4, GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 50) == ne);
+
+        char *waveformTmp = malloc(ne);
+        CHECK(waveformTmp != NULL);
+
+        ret = ggwave_txRender(instance, waveformTmp, ne/2);
+        CHECK(ret > 0 && ret <= ne/2);
+
+        CHECK(ggwave_txRender(instance, waveformTmp + ret, ne - ret) == ne - ret);
+        CHECK(ggwave_txRender(instance, waveformTmp, ne) == 0); // done
+        CHECK(memcmp(waveformTmp, waveform, ne) == 0);
+
+        free(waveformTmp);
+    }
+
     // not enough output buffer size to store the decoded message
     ret = ggwave_ndecode(instance, waveform, ne, decoded, 3);
     CHECK(ret == -2); // fail
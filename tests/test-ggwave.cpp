@@ -1,14 +1,24 @@
 #include "ggwave/ggwave.h"
 
+#if !defined(PROGMEM)
+#define PROGMEM
+#endif
+
+#include "reed-solomon/rs.hpp"
+
+#include <chrono>
+#include <cmath>
 #include <cstring>
 #include <limits>
 #include <string>
+#include <thread>
 #include <typeinfo>
 #include <typeindex>
 #include <vector>
 #include <set>
 #include <cstdint>
 #include <map>
+#include <random>
 
 constexpr float iRandMax = 1.0f/float(RAND_MAX);
 float frand() { return float(rand()%RAND_MAX)*iRandMax; }
@@ -200,6 +210,661 @@ int main(int argc, char ** argv) {
         CHECK_F(instance.init(payload.size(), payload.c_str(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 101));
     }
 
+    // Reed-Solomon decoding with errors and erasures within the correction capacity: 2*errors + erasures <= ecc
+    {
+        const int msgLength = 20;
+        const int eccLength = 8;
+
+        std::vector<uint8_t> work(RS::ReedSolomon::getWorkSize_bytes(msgLength, eccLength));
+        std::vector<uint8_t> msg(msgLength);
+        std::vector<uint8_t> encoded(msgLength + eccLength);
+        std::vector<uint8_t> decoded(msgLength);
+        std::vector<uint8_t> erasures(eccLength);
+
+        for (int i = 0; i < msgLength; ++i) {
+            msg[i] = 7*i + 3;
+        }
+
+        RS::ReedSolomon rs(msgLength, eccLength, work.data());
+        rs.Encode(msg.data(), encoded.data());
+
+        for (int nErrors = 0; 2*nErrors <= eccLength; ++nErrors) {
+            for (int nErasures = 0; 2*nErrors + nErasures <= eccLength; ++nErasures) {
+                auto received = encoded;
+
+                // the erasures at the front, the errors at the back, half of the erased bytes are correct
+                for (int i = 0; i < nErasures; ++i) {
+                    erasures[i] = 3*i;
+                    received[3*i] ^= (i % 2) ? 0x5a : 0;
+                }
+                for (int i = 0; i < nErrors; ++i) {
+                    received[msgLength + eccLength - 1 - 2*i] ^= 0xa5;
+                }
+
+                CHECK(rs.Decode(received.data(), decoded.data(), erasures.data(), nErasures) == 0);
+                CHECK(decoded == msg);
+                CHECK(rs.error_count == nErrors);
+            }
+        }
+
+        // more errors than the ECC bytes can correct are rejected, not corrected to another codeword
+        {
+            auto received = encoded;
+            for (int i = 0; i < 3; ++i) {
+                erasures[i] = i;
+            }
+            for (int i = 0; i < 3; ++i) {
+                received[msgLength + i] ^= 0x33;
+            }
+
+            CHECK(rs.Decode(received.data(), decoded.data(), erasures.data(), 3) != 0);
+        }
+
+        // with ECC bytes reserved for detecting a wrong correction, a decoding at the full capacity is rejected and
+        // the output is not written
+        {
+            auto received = encoded;
+            for (int i = 0; i < 4; ++i) {
+                erasures[i] = i;
+                received[i] ^= 0x33;
+            }
+            received[msgLength] ^= 0x33;
+            received[msgLength + 1] ^= 0x33;
+
+            std::vector<uint8_t> untouched(msgLength, 0xee);
+            auto output = untouched;
+
+            rs.ecc_reserved = 2;
+            CHECK(rs.Decode(received.data(), output.data(), erasures.data(), 4) != 0);
+            CHECK(output == untouched);
+            received[msgLength + 1] ^= 0x33;
+            CHECK(rs.Decode(received.data(), output.data(), erasures.data(), 4) == 0);
+            CHECK(output == msg);
+            rs.ecc_reserved = 0;
+        }
+    }
+
+    // cached and shared tone templates produce the same waveform
+    {
+        auto parameters = GGWave::getDefaultParameters();
+
+        GGWave instance(parameters);
+        GGWave instanceShared(parameters);
+
+        auto encodeHelper = [](GGWave & instance, const std::string & payload, GGWave::TxProtocolId protocolId) {
+            instance.init(payload.size(), payload.data(), protocolId, 25);
+            const auto nBytes = instance.encode();
+            return std::vector<uint8_t>((const uint8_t *) instance.txWaveform(), (const uint8_t *) instance.txWaveform() + nBytes);
+        };
+
+        const auto waveform0 = encodeHelper(instance, "templates", GGWAVE_PROTOCOL_AUDIBLE_FAST);
+        const auto waveform1 = encodeHelper(instance, "templates", GGWAVE_PROTOCOL_ULTRASOUND_FAST);
+        const auto waveform2 = encodeHelper(instance, "templates", GGWAVE_PROTOCOL_AUDIBLE_FAST);
+
+        CHECK(waveform0.size() > 0);
+        CHECK(waveform0 == waveform2);
+        CHECK(waveform0 != waveform1);
+
+        // the source has the templates of the audible and the ultrasound protocols, but not of the DT protocols
+        CHECK(instanceShared.txShareTemplates(&instance));
+        CHECK(encodeHelper(instanceShared, "templates", GGWAVE_PROTOCOL_AUDIBLE_FAST) == waveform0);
+        CHECK(encodeHelper(instanceShared, "templates", GGWAVE_PROTOCOL_ULTRASOUND_FAST) == waveform1);
+
+        const auto waveformDT = encodeHelper(instanceShared, "templates", GGWAVE_PROTOCOL_DT_FAST);
+        CHECK(encodeHelper(instance, "templates", GGWAVE_PROTOCOL_DT_FAST) == waveformDT);
+
+        // the source encodes with other protocols while the shared templates are being rendered
+        {
+            CHECK(encodeHelper(instance, "templates", GGWAVE_PROTOCOL_AUDIBLE_FAST) == waveform0);
+
+            const std::string payload = "templates";
+            instanceShared.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25);
+
+            std::vector<char> rendered;
+            std::vector<char> chunk(512*instanceShared.sampleSizeOut());
+
+            CHECK(instanceShared.txBegin());
+            for (int i = 0; ; ++i) {
+                if (i == 4) {
+                    CHECK(encodeHelper(instance, "templates", GGWAVE_PROTOCOL_DT_FAST) == waveformDT);
+                    CHECK(encodeHelper(instance, "templates", GGWAVE_PROTOCOL_ULTRASOUND_FAST) == waveform1);
+                }
+
+                const int nSamples = instanceShared.txRender(chunk.data(), 512);
+                rendered.insert(rendered.end(), chunk.begin(), chunk.begin() + nSamples*instanceShared.sampleSizeOut());
+                if (nSamples < 512) break;
+            }
+
+            CHECK(rendered.size() == waveform0.size());
+            CHECK(memcmp(rendered.data(), waveform0.data(), waveform0.size()) == 0);
+        }
+
+        auto parametersOther = parameters;
+        parametersOther.sampleRate = 44100.0f;
+
+        GGWave instanceOther(parametersOther);
+        CHECK_F(instanceOther.txShareTemplates(&instance));
+        CHECK_T(instanceOther.txShareTemplates(nullptr));
+    }
+
+    // the oscillator generates the same waveform as the tone templates
+    {
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_F32;
+
+        GGWave instance(parameters);
+
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_TX_OSCILLATOR;
+        GGWave instanceOscillator(parameters);
+
+        CHECK(instanceOscillator.heapSize() < instance.heapSize());
+
+        for (auto protocolId : { GGWAVE_PROTOCOL_AUDIBLE_NORMAL, GGWAVE_PROTOCOL_ULTRASOUND_FASTEST, GGWAVE_PROTOCOL_DT_FAST }) {
+            const std::string payload = "oscillator";
+
+            instance.init(payload.size(), payload.data(), protocolId, 50);
+            instanceOscillator.init(payload.size(), payload.data(), protocolId, 50);
+
+            const int n = instance.encode();
+            CHECK(n > 0);
+            CHECK(n == (int) instanceOscillator.encode());
+
+            const float * expected = (const float *) instance.txWaveform();
+            const float * actual   = (const float *) instanceOscillator.txWaveform();
+
+            float maxDiff = 0.0f;
+            for (int i = 0; i < n/(int) sizeof(float); ++i) {
+                maxDiff = std::max(maxDiff, std::fabs(expected[i] - actual[i]));
+            }
+            printf("Oscillator: protocol %d, max difference = %g\n", (int) protocolId, maxDiff);
+            CHECK(maxDiff < 1e-4f);
+        }
+    }
+
+    // streaming Tx vs encode()
+    {
+        for (auto sampleFormatOut : { GGWAVE_SAMPLE_FORMAT_F32, GGWAVE_SAMPLE_FORMAT_I16 }) {
+            for (auto sampleRateOut : { 48000.0f, 44100.0f }) {
+                auto parameters = GGWave::getDefaultParameters();
+                parameters.sampleFormatOut = sampleFormatOut;
+                parameters.sampleRateOut   = sampleRateOut;
+
+                GGWave instance(parameters);
+
+                parameters.operatingMode |= GGWAVE_OPERATING_MODE_TX_STREAMING;
+                GGWave instanceStreaming(parameters);
+
+                CHECK(instanceStreaming.heapSize() < instance.heapSize());
+                CHECK(instanceStreaming.encode() == 0);
+
+                const std::string payload = "streaming";
+
+                instance.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 50);
+                instanceStreaming.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 50);
+
+                const int n = instance.encode();
+                CHECK(n > 0);
+
+                std::vector<char> rendered;
+                std::vector<char> chunk(333*instanceStreaming.sampleSizeOut());
+
+                CHECK(instanceStreaming.txBegin());
+                while (true) {
+                    const int nSamples = instanceStreaming.txRender(chunk.data(), 333);
+                    rendered.insert(rendered.end(), chunk.begin(), chunk.begin() + nSamples*instanceStreaming.sampleSizeOut());
+                    if (nSamples < 333) break;
+                }
+
+                CHECK(instanceStreaming.txHasData() == false);
+                CHECK(instanceStreaming.txRender(chunk.data(), 333) == 0);
+                CHECK((int) rendered.size() == n);
+                CHECK(memcmp(rendered.data(), instance.txWaveform(), n) == 0);
+            }
+        }
+    }
+
+    // txRender() without txBegin() renders nothing, on a fresh instance and after a transmission
+    {
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_TX_STREAMING;
+
+        GGWave instance(parameters);
+
+        const std::string payload = "hello";
+
+        std::vector<char> rendered(instance.samplesPerFrame()*instance.sampleSizeOut());
+
+        for (int i = 0; i < 2; ++i) {
+            instance.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25);
+            CHECK(instance.txRender(rendered.data(), instance.samplesPerFrame()) == 0);
+            CHECK(instance.txHasData());
+
+            const int n = instance.encodeSize_samples();
+            CHECK(n > 0);
+
+            int nTotal = 0;
+            CHECK(instance.txBegin());
+            while (true) {
+                const int nSamples = instance.txRender(rendered.data(), instance.samplesPerFrame());
+                if (nSamples == 0) break;
+                nTotal += nSamples;
+            }
+
+            CHECK(nTotal == n);
+            CHECK(instance.txHasData() == false);
+        }
+    }
+
+    // resampling in chunks vs in a single call
+    {
+        const float kRates[][2] = { { 44100.0f, 48000.0f }, { 48000.0f, 44100.0f }, { 96000.0f, 48000.0f }, { 22050.0f, 48000.0f }, { 44100.5f, 48000.0f } };
+
+        std::vector<float> signal(20000);
+        for (auto & x : signal) {
+            x = frand() - 0.5f;
+        }
+
+        for (const auto & rates : kRates) {
+            GGWave::Resampler resampler;
+
+            int n = 0;
+            CHECK(resampler.alloc(nullptr, n, rates[0], rates[1]));
+            std::vector<uint8_t> work(n);
+            n = 0;
+            CHECK(resampler.alloc(work.data(), n, rates[0], rates[1]));
+
+            std::vector<float> expected(3*signal.size());
+            const int nExpected = resampler.predictOutputSamples(signal.size());
+            CHECK(resampler.resample(signal.size(), signal.data(), expected.data()) == nExpected);
+
+            resampler.reset();
+
+            std::vector<float> actual(3*signal.size());
+            int nActual = 0;
+            for (int offset = 0, chunk = 1; offset < (int) signal.size(); offset += chunk, chunk = (3*chunk + 7) % 1000) {
+                chunk = std::min(chunk, (int) signal.size() - offset);
+                const int nPredicted = resampler.predictOutputSamples(chunk);
+                if (nPredicted > 0) {
+                    CHECK(resampler.predictInputSamples(nPredicted) <= chunk);
+                    CHECK(resampler.predictOutputSamples(resampler.predictInputSamples(nPredicted)) >= nPredicted);
+                }
+                CHECK(resampler.resample(chunk, signal.data() + offset, actual.data() + nActual) == nPredicted);
+                nActual += nPredicted;
+            }
+
+            CHECK(nActual == nExpected);
+            for (int i = 0; i < nExpected; ++i) {
+                CHECK(std::fabs(actual[i] - expected[i]) < 1e-5f);
+            }
+        }
+    }
+
+    // FFT vs DFT
+    for (int N = 2; N <= GGWave::kMaxSamplesPerFrame; N *= 2) {
+        std::vector<float> src(N);
+        for (auto & x : src) {
+            x = frand() - 0.5f;
+        }
+
+        std::vector<int>   wi(GGWave::computeFFTR(nullptr, nullptr, N, nullptr, nullptr));
+        std::vector<float> wf(GGWave::computeFFTR(nullptr, nullptr, N, wi.data(), nullptr));
+        std::vector<float> dst(2*N, 1.0f);
+        CHECK(GGWave::computeFFTR(src.data(), dst.data(), N, wi.data(), wf.data()) == 1);
+
+        for (int k = 0; k < N/2; ++k) {
+            double re = 0.0;
+            double im = 0.0;
+            for (int j = 0; j < N; ++j) {
+                re += src[j]*cos(2.0*M_PI*j*k/N);
+                im += src[j]*sin(2.0*M_PI*j*k/N);
+            }
+            // for bin 0, the imaginary part is replaced with the real part of bin N/2
+            if (k == 0) {
+                im = 0.0;
+                for (int j = 0; j < N; ++j) {
+                    im += j % 2 == 0 ? src[j] : -src[j];
+                }
+            }
+            CHECK(std::fabs(dst[2*k + 0] - re) < 1e-4f);
+            CHECK(std::fabs(dst[2*k + 1] - im) < 1e-4f);
+        }
+        for (int i = N; i < 2*N; ++i) {
+            CHECK(dst[i] == 0.0f);
+        }
+    }
+    {
+        int   wi = 0;
+        float wf = 0.0f;
+        std::vector<float> src(1000), dst(2000);
+        CHECK(GGWave::computeFFTR(src.data(), dst.data(), 1000, &wi, &wf) == 0);
+    }
+
+    // batched FFT vs single frame FFT
+    for (int N = 256; N <= GGWave::kMaxSamplesPerFrame; N *= 4) {
+        const int count  = 11;
+        const int stride = N/4;
+
+        std::vector<float> src((count - 1)*stride + N);
+        for (auto & x : src) {
+            x = frand() - 0.5f;
+        }
+
+        std::vector<float> batch(2*N*count);
+        CHECK(GGWave::computeFFTRBatch(src.data(), batch.data(), N, count, stride));
+
+        int wi = 0;
+        float wf = 0.0f;
+        std::vector<float> single(2*N);
+        for (int i = 0; i < count; ++i) {
+            CHECK(GGWave::computeFFTR(src.data() + i*stride, single.data(), N, &wi, &wf) == 1);
+            CHECK(memcmp(single.data(), batch.data() + 2*i*N, 2*N*sizeof(float)) == 0);
+        }
+    }
+    CHECK_F(GGWave::computeFFTRBatch(nullptr, nullptr, 1000, 1, 1000));
+
+    // sliding DFT vs FFT
+    {
+        const int N = 1024;
+        const int K = 16;
+        const int bins[] = { 0, 3, 40, 41, 100, 320, 511 };
+        const int nBins = sizeof(bins)/sizeof(bins[0]);
+
+        GGWave::SlidingDFT sdft;
+
+        int n = 0;
+        CHECK(sdft.alloc(nullptr, n, N, K, nBins));
+        std::vector<uint8_t> work(n);
+        n = 0;
+        CHECK(sdft.alloc(work.data(), n, N, K, nBins));
+        CHECK(sdft.setBins(bins, nBins));
+
+        std::vector<float> signal(4*N);
+        for (auto & x : signal) {
+            x = frand() - 0.5f;
+        }
+
+        std::vector<int>   wi(2*N);
+        std::vector<float> wf(N);
+        std::vector<float> fft(2*N);
+
+        for (int h = 0; h*sdft.hopSize() + N <= (int) signal.size(); ++h) {
+            CHECK((h >= K - 1) == sdft.push(signal.data() + h*sdft.hopSize()));
+            if (h < K - 1) continue;
+
+            const float * window = signal.data() + (h - K + 1)*sdft.hopSize();
+            CHECK(GGWave::computeFFTR(window, fft.data(), N, wi.data(), wf.data()) == 1);
+
+            for (int i = 0; i < nBins; ++i) {
+                CHECK(std::fabs(sdft.output()[2*i + 0] - fft[2*bins[i] + 0]) < 1e-2f);
+                // for bin 0, computeFFTR() stores the real part of bin N/2 in place of the imaginary part
+                if (bins[i] == 0) continue;
+                CHECK(std::fabs(sdft.output()[2*i + 1] - fft[2*bins[i] + 1]) < 1e-2f);
+            }
+        }
+    }
+
+    // decoding with an executor that runs the tasks on separate threads
+    {
+        int nRuns = 0;
+
+        GGWave::Executor executor;
+        executor.nWorkers = 4;
+        executor.userData = &nRuns;
+        executor.run = [](void * userData, GGWave::Executor::Task task, void * taskData, int nTasks) {
+            ++*(int *) userData;
+
+            std::vector<std::thread> workers;
+            for (int i = 0; i < nTasks; ++i) {
+                workers.emplace_back(task, taskData, i);
+            }
+            for (auto & worker : workers) {
+                worker.join();
+            }
+        };
+
+        auto parameters = GGWave::getDefaultParameters();
+
+        std::string payload(64, ' ');
+        for (int i = 0; i < (int) payload.size(); ++i) {
+            payload[i] = 'a' + i%26;
+        }
+
+        for (const auto protocolId : { GGWAVE_PROTOCOL_AUDIBLE_FAST, GGWAVE_PROTOCOL_DT_FASTEST }) {
+            printf("Testing: executor, protocol = %d\n", protocolId);
+
+            GGWave instance;
+            CHECK(instance.prepare(parameters, executor));
+
+            instance.init(payload.size(), payload.data(), protocolId, 25);
+            const auto nBytes = instance.encode();
+            { auto p = (const uint8_t *)(instance.txWaveform()); buffer.resize(nBytes); memcpy(buffer.data(), p, nBytes); }
+            addNoiseHelper(0.02, parameters.sampleFormatOut);
+            convertHelper(parameters.sampleFormatOut, parameters.sampleFormatInp);
+            instance.decode(buffer.data(), buffer.size());
+
+            GGWave::TxRxData result;
+            CHECK(instance.rxTakeData(result) == (int) payload.size());
+            CHECK(memcmp(result.data(), payload.data(), payload.size()) == 0);
+        }
+
+        CHECK(nRuns > 0);
+    }
+
+    // amortized analysis - decode frame by frame
+    {
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_AMORTIZED;
+
+        const std::string payload = "amortized analysis";
+
+        GGWave instance(parameters);
+
+        instance.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 25);
+        const auto nBytes = instance.encode();
+        { auto p = (const uint8_t *)(instance.txWaveform()); buffer.resize(nBytes); memcpy(buffer.data(), p, nBytes); }
+        addNoiseHelper(0.02, parameters.sampleFormatOut);
+
+        const int frameSize = instance.samplesPerFrame()*instance.sampleSizeInp();
+        buffer.resize(buffer.size() + 32*frameSize, 0);
+
+        GGWave::TxRxData result;
+
+        int n = 0;
+        for (int offset = 0; offset + frameSize <= (int) buffer.size() && n == 0; offset += frameSize) {
+            instance.decode(buffer.data() + offset, frameSize);
+
+            if (instance.rxAnalyzing()) {
+                const int nLeft = instance.rxFramesLeftToAnalyze();
+                CHECK(nLeft > 0);
+                instance.rxStep(0);
+                CHECK(instance.rxAnalyzing() == false || instance.rxFramesLeftToAnalyze() < nLeft);
+            }
+
+            n = instance.rxTakeData(result);
+        }
+
+        CHECK(n == (int) payload.size());
+        CHECK(memcmp(result.data(), payload.data(), payload.size()) == 0);
+    }
+
+    // amortized analysis - rxStopReceiving() drops the analysis in progress. The slow executor makes the analysis
+    // take more than one frame
+    {
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_AMORTIZED;
+
+        GGWave::Executor executor;
+        executor.nWorkers = 2;
+        executor.run = [](void * , GGWave::Executor::Task task, void * taskData, int nTasks) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            for (int i = 0; i < nTasks; ++i) {
+                task(taskData, i);
+            }
+        };
+
+        const std::string payload0 = "dropped analysis";
+        const std::string payload1 = "next message";
+
+        GGWave instance;
+        CHECK(instance.prepare(parameters, executor));
+
+        const int frameSize = instance.samplesPerFrame()*instance.sampleSizeInp();
+
+        GGWave::TxRxData result;
+
+        bool isStopped = false;
+        for (const auto & payload : { payload0, payload1 }) {
+            instance.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 25);
+            const auto nBytes = instance.encode();
+            { auto p = (const uint8_t *)(instance.txWaveform()); buffer.resize(nBytes); memcpy(buffer.data(), p, nBytes); }
+            buffer.resize(buffer.size() + 32*frameSize, 0);
+
+            int n = 0;
+            for (int offset = 0; offset + frameSize <= (int) buffer.size() && n == 0; offset += frameSize) {
+                instance.decode(buffer.data() + offset, frameSize);
+
+                if (instance.rxAnalyzing()) {
+                    if (isStopped) {
+                        while (instance.rxStep(-1)) {}
+                    } else {
+                        CHECK(instance.rxStopReceiving());
+                        CHECK(instance.rxAnalyzing() == false);
+                        CHECK(instance.rxFramesLeftToAnalyze() == 0);
+                        CHECK(instance.rxStep(-1) == false);
+                        CHECK(instance.rxStopReceiving() == false);
+                        isStopped = true;
+                    }
+                }
+
+                n = instance.rxTakeData(result);
+            }
+
+            if (payload == payload0) {
+                CHECK(isStopped);
+                CHECK(n <= 0);
+            } else {
+                CHECK(n == (int) payload.size());
+                CHECK(memcmp(result.data(), payload.data(), payload.size()) == 0);
+            }
+        }
+    }
+
+    // amortized analysis - back-to-back transmissions
+    {
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_AMORTIZED;
+
+        const std::string payload0 = "first message";
+        const std::string payload1 = "second message";
+
+        GGWave instance(parameters);
+
+        const int frameSize = instance.samplesPerFrame()*instance.sampleSizeInp();
+
+        std::vector<uint8_t> waveform;
+        for (const auto & payload : { payload0, payload1 }) {
+            instance.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 25);
+            const auto nBytes = instance.encode();
+            { auto p = (const uint8_t *)(instance.txWaveform()); buffer.resize(nBytes); memcpy(buffer.data(), p, nBytes); }
+            addNoiseHelper(0.02, parameters.sampleFormatOut);
+
+            waveform.insert(waveform.end(), buffer.begin(), buffer.end());
+            waveform.resize(waveform.size() + 4*frameSize, 0);
+        }
+        waveform.resize(waveform.size() + 32*frameSize, 0);
+
+        std::vector<std::string> received;
+        for (int offset = 0; offset + frameSize <= (int) waveform.size(); offset += frameSize) {
+            instance.decode(waveform.data() + offset, frameSize);
+
+            GGWave::TxRxData result;
+            const int n = instance.rxTakeData(result);
+            if (n > 0) {
+                received.emplace_back((const char *) result.data(), n);
+            }
+        }
+
+        CHECK(received.size() == 2);
+        CHECK(received.size() > 0 && received[0] == payload0);
+        CHECK(received.size() > 1 && received[1] == payload1);
+    }
+
+    // amortized analysis - the next transmission ends while the previous one is still analyzed. The slow executor
+    // exceeds the budget, so each decode() call runs at most the decoding of the recorded candidates and a single
+    // piece of the analysis
+    {
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_AMORTIZED;
+
+        int nRuns = 0;
+
+        GGWave::Executor executor;
+        executor.nWorkers = 2;
+        executor.userData = &nRuns;
+        executor.run = [](void * userData, GGWave::Executor::Task task, void * taskData, int nTasks) {
+            ++*(int *) userData;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            for (int i = 0; i < nTasks; ++i) {
+                task(taskData, i);
+            }
+        };
+
+        const std::string payload0 = "first";
+        const std::string payload1 = "second";
+
+        GGWave instance;
+        CHECK(instance.prepare(parameters, executor));
+
+        const int frameSize = instance.samplesPerFrame()*instance.sampleSizeInp();
+
+        std::vector<uint8_t> waveform;
+        for (const auto & payload : { payload0, payload1 }) {
+            instance.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 25);
+            const auto nBytes = instance.encode();
+            { auto p = (const uint8_t *)(instance.txWaveform()); buffer.resize(nBytes); memcpy(buffer.data(), p, nBytes); }
+
+            waveform.insert(waveform.end(), buffer.begin(), buffer.end());
+            waveform.resize(waveform.size() + 4*frameSize, 0);
+        }
+        waveform.resize(waveform.size() + 32*frameSize, 0);
+
+        bool isQueued = false;
+
+        std::vector<std::string> received;
+        for (int offset = 0; offset + frameSize <= (int) waveform.size(); offset += frameSize) {
+            nRuns = 0;
+            instance.decode(waveform.data() + offset, frameSize);
+            CHECK(nRuns <= 2);
+
+            // the recording is complete, but its analysis waits for the previous one
+            if (instance.rxAnalyzing() && instance.rxReceiving() && instance.rxFramesLeftToRecord() == 0) {
+                isQueued = true;
+            }
+
+            GGWave::TxRxData result;
+            const int n = instance.rxTakeData(result);
+            if (n > 0) {
+                received.emplace_back((const char *) result.data(), n);
+            }
+        }
+
+        // the queued analysis starts when the previous one completes
+        while (instance.rxAnalyzing()) {
+            instance.rxStep(-1);
+
+            GGWave::TxRxData result;
+            const int n = instance.rxTakeData(result);
+            if (n > 0) {
+                received.emplace_back((const char *) result.data(), n);
+            }
+        }
+
+        CHECK(isQueued);
+        CHECK(received.size() == 2);
+        CHECK(received.size() > 0 && received[0] == payload0);
+        CHECK(received.size() > 1 && received[1] == payload1);
+    }
+
     // playback / capture at different sample rates
     for (int srInp = GGWave::kDefaultSampleRate/6; srInp <= 2*GGWave::kDefaultSampleRate; srInp += 1371) {
         printf("Testing: sample rate = %d\n", srInp);
@@ -218,7 +883,7 @@ int main(int argc, char ** argv) {
             const auto expectedSize = instanceOut.encodeSize_bytes();
             const auto nBytes = instanceOut.encode();
             printf("Expected = %d, actual = %d\n", expectedSize, nBytes);
-            CHECK(expectedSize >= nBytes);
+            CHECK(expectedSize == nBytes);
             { auto p = (const uint8_t *)(instanceOut.txWaveform()); buffer.resize(nBytes); memcpy(buffer.data(), p, nBytes); }
             addNoiseHelper(0.01, parameters.sampleFormatOut); // add some artificial noise
             convertHelper(parameters.sampleFormatOut, parameters.sampleFormatInp);
@@ -237,7 +902,129 @@ int main(int argc, char ** argv) {
             for (int i = 0; i < (int) payload.size(); ++i) {
                 CHECK(payload[i] == result[i]);
             }
+
+            // the same data in small chunks
+            GGWave instanceChunks(parameters);
+            instanceChunks.rxProtocols().only(GGWAVE_PROTOCOL_DT_FASTEST);
+
+            const int chunkSize = 100*instanceChunks.sampleSizeInp();
+
+            int nDecoded = 0;
+            for (int offset = 0; offset < (int) buffer.size(); offset += chunkSize) {
+                instanceChunks.decode(buffer.data() + offset, std::min(chunkSize, (int) buffer.size() - offset));
+                nDecoded = std::max(nDecoded, instanceChunks.rxTakeData(result));
+            }
+            CHECK(nDecoded == (int) payload.size());
+        }
+    }
+
+    // frames larger than the default at 96 kHz
+    for (int samplesPerFrame = 2*GGWave::kDefaultSamplesPerFrame; samplesPerFrame <= GGWave::kMaxSamplesPerFrame; samplesPerFrame *= 2) {
+        printf("Testing: samples per frame = %d\n", samplesPerFrame);
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.sampleRate      = 96000;
+        parameters.sampleRateInp   = 96000;
+        parameters.sampleRateOut   = 96000;
+        parameters.samplesPerFrame = samplesPerFrame;
+
+        const std::string payload = "hello123";
+
+        GGWave instance(parameters);
+        instance.rxProtocols().only(GGWAVE_PROTOCOL_ULTRASOUND_FASTEST);
+
+        CHECK(instance.init(payload.c_str(), GGWAVE_PROTOCOL_ULTRASOUND_FASTEST, 25));
+        const auto expectedSize = instance.encodeSize_bytes();
+        const auto nBytes = instance.encode();
+        CHECK(expectedSize == nBytes);
+        { auto p = (const uint8_t *)(instance.txWaveform()); buffer.resize(nBytes); memcpy(buffer.data(), p, nBytes); }
+        addNoiseHelper(0.02, parameters.sampleFormatOut);
+        convertHelper(parameters.sampleFormatOut, parameters.sampleFormatInp);
+        instance.decode(buffer.data(), buffer.size());
+
+        GGWave::TxRxData result;
+        CHECK(instance.rxTakeData(result) == (int) payload.size());
+        CHECK(memcmp(result.data(), payload.data(), payload.size()) == 0);
+    }
+
+    // fixed-length decoding computes only the bins of the Rx protocols. The full spectrum of the last frame is
+    // computed on demand
+    {
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.payloadLength   = 8;
+        parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_F32;
+        parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_F32;
+
+        const std::string payload = "band1234";
+
+        GGWave instance(parameters);
+        instance.rxProtocols().only(GGWAVE_PROTOCOL_ULTRASOUND_FASTEST);
+
+        CHECK(instance.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_ULTRASOUND_FASTEST, 25));
+        const int nBytes = instance.encode();
+        std::vector<float> samples(nBytes/sizeof(float));
+        memcpy(samples.data(), instance.txWaveform(), nBytes);
+
+        const int N = instance.samplesPerFrame();
+        CHECK(samples.size() % N == 0);
+
+        instance.decode(samples.data(), nBytes);
+
+        GGWave::TxRxData result;
+        CHECK(instance.rxTakeData(result) == (int) payload.size());
+        CHECK(memcmp(result.data(), payload.data(), payload.size()) == 0);
+
+        int wi;
+        float wf;
+        std::vector<float> fft(2*N);
+        CHECK(GGWave::computeFFTR(samples.data() + samples.size() - N, fft.data(), N, &wi, &wf) == 1);
+
+        GGWave::Spectrum spectrum;
+        CHECK(instance.rxTakeSpectrum(spectrum));
+        CHECK(spectrum.size() == N);
+        for (int i = 1; i < N/2; ++i) {
+            const float expected = fft[2*i + 0]*fft[2*i + 0] + fft[2*i + 1]*fft[2*i + 1];
+            CHECK(std::fabs(spectrum[i] - expected) <= 1e-4f*(1.0f + expected));
+        }
+    }
+
+    // fixed-length decoding retries with the least reliable bytes as erasures. At this noise level, the plain
+    // Reed-Solomon decoding recovers 8 of the 20 payloads and the retries 5 more
+    {
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.payloadLength   = 32;
+        parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_F32;
+        parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_F32;
+
+        const std::string payload = "erasures: the least reliable b..";
+
+        int nDecoded = 0;
+        for (int seed = 0; seed < 20; ++seed) {
+            GGWave instance(parameters);
+            instance.rxProtocols().only(GGWAVE_PROTOCOL_AUDIBLE_FAST);
+
+            CHECK(instance.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25));
+            const int nBytes = instance.encode();
+            std::vector<float> samples(nBytes/sizeof(float));
+            memcpy(samples.data(), instance.txWaveform(), nBytes);
+
+            std::minstd_rand rng(seed);
+            for (auto & x : samples) {
+                x += 0.8f*(float(rng())/std::minstd_rand::max() - 0.5f);
+            }
+
+            instance.decode(samples.data(), nBytes);
+
+            GGWave::TxRxData result;
+            const int n = instance.rxTakeData(result);
+            if (n > 0) {
+                CHECK(n == (int) payload.size());
+                CHECK(memcmp(result.data(), payload.data(), payload.size()) == 0);
+                ++nDecoded;
+            }
         }
+        printf("Decoded %d / 20 noisy payloads\n", nDecoded);
+        CHECK(nDecoded >= 12);
     }
 
     const std::string payload = "a0Z5kR2g";
@@ -286,6 +1073,13 @@ int main(int argc, char ** argv) {
                         for (int i = 0; i < length; ++i) {
                             CHECK(payload[i] == result[i]);
                         }
+                        CHECK(instance.rxStats().nFFT > 0);
+
+                        const auto & stats = instance.rxStats();
+                        CHECK(stats.nRSDecodes > 0);
+                        CHECK(stats.nRSDecodes >= stats.nRSLocator);
+                        CHECK(stats.nRSLocator >= stats.nRSChien);
+                        CHECK(stats.nRSChien >= stats.nRSCorrected);
                     }
                 }
 